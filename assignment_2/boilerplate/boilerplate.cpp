@@ -27,7 +27,10 @@
 #include <GLFW/glfw3.h>
 
 #include "texture.h"
+#include "framebuffer.h"
+#include "texturecache.h"
 #include <vector>
+#include <cmath>
 
 using namespace std;
 using namespace glm;
@@ -38,12 +41,30 @@ void QueryGLVersion();
 bool CheckGLErrors();
 
 string LoadSource(const string &filename);
-GLuint CompileShader(GLenum shaderType, const string &source);
+GLuint CompileShader(GLenum shaderType, const string &source, const string &defines = "");
 GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader);
 
+// images shown, in the order the arrow keys step through them; img is the
+// number of the current one, from 1
+const char *IMAGE_FILES[] = {
+    "images/image1-mandrill.png",
+    "images/image2-uclogo.png",
+    "images/image3-aerial.jpg",
+    "images/image4-thirsk.jpg",
+    "images/image5-pattern.png",
+    "images/city.jpg"
+};
+const int IMAGE_COUNT = sizeof(IMAGE_FILES) / sizeof(IMAGE_FILES[0]);
+
 int img = 1;
 bool newImg = false;
 
+// decoded images are kept as textures, up to this much GPU memory, so
+// images seen recently and the ones either side of the current one show
+// without loading. Images are loaded in the background, and the last one
+// shown stays on screen until the next is ready.
+const size_t TEXTURE_BUDGET = 32 << 20;
+
 bool mouseClicked;
 double initPosX, initPosY;
 double offsetX = 0.0, offsetY = 0.0;
@@ -53,22 +74,46 @@ double magnification = 1.0;
 float theta = 0.0f;
 bool keyA = false, keyD = false;
 
-int effect = 0;
+// Effects applied to the image, in order: a number key picks one effect,
+// and with shift held adds it to the end of the list, up to
+// MAX_CHAINED_EFFECTS of them
+vector<int> effects;
+const size_t MAX_CHAINED_EFFECTS = 8;
+
+// Each effect done in fragment.glsl (1 to 7) has its own program, compiled
+// with EFFECT defined to it so it holds only that effect's code; variant 0
+// draws the image as it is
+const int EFFECT_PROGRAMS = 8;
+
+// Gaussian blurs (effects 8 to 11) run as two 1D passes through a
+// framebuffer; effect 11 has an adjustable radius, up to MAX_BLUR_RADIUS
+// texels
+const int MAX_BLUR_RADIUS = 64;
+int blurRadius = 25;
+
+// Kernels are uploaded to the shaders' Kernel uniform block, through this
+// binding point, and hold up to MAX_KERNEL_TAPS taps: enough for a blur pass
+// of MAX_BLUR_RADIUS once pairs of weights are merged
+const GLuint KERNEL_BINDING = 0;
+const int MAX_KERNEL_TAPS = 2 * (MAX_BLUR_RADIUS / 2) + 1;
 
 // --------------------------------------------------------------------------
 // Functions to set up OpenGL shader programs for rendering
 
-// load, compile, and link shaders, returning true if successful
-GLuint InitializeShaders()
+// load, compile, and link shaders, returning true if successful; defines
+// are added to the start of both sources
+GLuint InitializeShaders(const string &vertexFile = "shaders/vertex.glsl",
+                         const string &fragmentFile = "shaders/fragment.glsl",
+                         const string &defines = "")
 {
 	// load shader source from files
-	string vertexSource = LoadSource("shaders/vertex.glsl");
-	string fragmentSource = LoadSource("shaders/fragment.glsl");
+	string vertexSource = LoadSource(vertexFile);
+	string fragmentSource = LoadSource(fragmentFile);
 	if (vertexSource.empty() || fragmentSource.empty()) return false;
 
 	// compile shader source into shader objects
-	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
-	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource, defines);
+	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource, defines);
 
 	// link shader program
 	GLuint program = LinkProgram(vertex, fragment);
@@ -234,6 +279,245 @@ void DestroyGeometry(Geometry *geometry)
 	glDeleteBuffers(1, &geometry->vertexBuffer);
 }
 
+// --------------------------------------------------------------------------
+// Convolution kernels, built on the CPU and uploaded as uniform blocks
+
+// A kernel as laid out in the Kernel uniform block (std140) of the shaders:
+// each tap's offset from the pixel in texture coordinates in xy and its
+// weight in z
+struct KernelBlock
+{
+	vec4 taps[MAX_KERNEL_TAPS];
+	GLint tapCount;
+	GLint padding[3];
+};
+
+// taps of the 3x3 kernels of effects 5 to 7 (Sobel filters and unsharp
+// mask), with offsets in texels, top row first; empty for other effects
+vector<vec3> convolutionTaps(int effect) {
+    static const float verticalSobel[9] = {1.0f, 0.0f, -1.0f,
+                                           2.0f, 0.0f, -2.0f,
+                                           1.0f, 0.0f, -1.0f};
+    static const float horizontalSobel[9] = {-1.0f, -2.0f, -1.0f,
+                                             0.0f, 0.0f, 0.0f,
+                                             1.0f, 2.0f, 1.0f};
+    static const float unsharpMask[9] = {0.0f, -1.0f, 0.0f,
+                                         -1.0f, 5.0f, -1.0f,
+                                         0.0f, -1.0f, 0.0f};
+
+    const float *weights = 0;
+    switch (effect) {
+        case 5: weights = verticalSobel; break;
+        case 6: weights = horizontalSobel; break;
+        case 7: weights = unsharpMask; break;
+    }
+
+    vector<vec3> taps;
+    for (int i = 0; weights && i < 3; i++) {
+        for (int j = 0; j < 3; j++)
+            taps.push_back(vec3(j - 1, 1 - i, weights[3 * i + j]));
+    }
+    return taps;
+}
+
+// Weights of one side of a 1D Gaussian kernel, centre first, for a blur
+// effect: the fixed 3, 5 and 7 tap kernels of effects 8 to 10, or one of
+// blurRadius with the kernel's ends at 3 standard deviations for effect 11.
+// Empty for effects that are not blurs.
+vector<float> blurWeights(int effect) {
+    vector<float> weights;
+    switch (effect) {
+        case 8: weights = {0.6f, 0.2f}; break;
+        case 9: weights = {0.4f, 0.24f, 0.06f}; break;
+        case 10: weights = {0.28f, 0.22f, 0.11f, 0.03f}; break;
+        case 11: {
+            float sigma = std::max(blurRadius / 3.0f, 0.5f);
+            float sum = 0.0f;
+            for (int i = 0; i <= blurRadius; i++) {
+                weights.push_back(exp(-0.5f * i * i / (sigma * sigma)));
+                sum += (i == 0 ? 1.0f : 2.0f) * weights.back();
+            }
+            for (size_t i = 0; i < weights.size(); i++)
+                weights[i] /= sum;
+            break;
+        }
+    }
+    return weights;
+}
+
+// Taps of one pass of a blur along direction, with offsets in texels.
+// Neighbouring weights i and i + 1 are merged into one tap between their
+// texels, at the offset where linear filtering splits it back into the two
+// weights, so a kernel of radius r takes the centre and (r + 1) / 2 taps on
+// each side.
+vector<vec3> blurTaps(int effect, vec2 direction) {
+    vector<float> weights = blurWeights(effect);
+    vector<vec3> taps;
+    if (weights.empty())
+        return taps;
+
+    taps.push_back(vec3(0.0f, 0.0f, weights[0]));
+    for (size_t i = 1; i < weights.size(); i += 2) {
+        float a = weights[i];
+        float b = i + 1 < weights.size() ? weights[i + 1] : 0.0f;
+        vec2 offset = (i + b / (a + b)) * direction;
+        taps.push_back(vec3(offset, a + b));
+        taps.push_back(vec3(-offset, a + b));
+    }
+    return taps;
+}
+
+// uploads taps, with offsets in texels of image, into a kernel uniform buffer
+void LoadKernel(GLuint buffer, const vector<vec3> &taps, MyTexture *image)
+{
+	KernelBlock block;
+	block.tapCount = std::min((int)taps.size(), MAX_KERNEL_TAPS);
+	for (int i = 0; i < block.tapCount; i++) {
+		block.taps[i] = vec4(taps[i].x / image->width, taps[i].y / image->height,
+		                     taps[i].z, 0.0f);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(KernelBlock), &block, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// points the Kernel uniform block of program at KERNEL_BINDING
+void BindKernelBlock(GLuint program)
+{
+	GLuint index = glGetUniformBlockIndex(program, "Kernel");
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, KERNEL_BINDING);
+}
+
+// --------------------------------------------------------------------------
+// Effect chain, applied to the image in framebuffers
+
+// draws source into target through program, with the taps in kernel
+void RenderPass(MyTexture *source, MyFramebuffer *target, GLuint program, GLuint vertexArray,
+                GLuint kernel)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, target->framebufferID);
+	glViewport(0, 0, target->texture.width, target->texture.height);
+
+	glUseProgram(program);
+	glBindBufferBase(GL_UNIFORM_BUFFER, KERNEL_BINDING, kernel);
+	glBindTexture(GL_TEXTURE_2D, source->textureID);
+	glBindVertexArray(vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+// The result of applying a list of effects to an image, kept until the
+// image, the effects or the blur radius change, so that moving the image
+// around only draws the result. Effects are applied in image space, each
+// reading the last one's result from one framebuffer and writing into the
+// other; blurs go through a third for their horizontal pass.
+struct EffectChain
+{
+	// what the result was made from
+	vector<int> effects;
+	int blurRadius;
+	string image;
+
+	MyFramebuffer targets[2];
+	MyFramebuffer blurIntermediate;
+	MyTexture *result;
+
+	// kernel uniform buffers, two for each effect
+	vector<GLuint> kernels;
+
+	// vertex array with no buffers, for passes to draw their covering
+	// triangle with
+	GLuint vertexArray;
+
+	EffectChain() : blurRadius(0), result(0), vertexArray(0)
+	{}
+};
+
+// Applies effects to image, read from the file imageName, if they (or the
+// image or blur radius) are not what chain holds already, and returns the
+// texture to draw: the last effect's result, or the image itself when there
+// are no effects. passPrograms are the variants of fragment.glsl drawn over
+// the image.
+MyTexture *ApplyEffects(EffectChain *chain, MyTexture *image, const string &imageName,
+                        const vector<int> &effects, const GLuint *passPrograms,
+                        GLuint blurProgram)
+{
+	if (effects.empty())
+		return image;
+	if (chain->result && chain->effects == effects && chain->blurRadius == blurRadius &&
+	    chain->image == imageName)
+		return chain->result;
+
+	chain->effects = effects;
+	chain->blurRadius = blurRadius;
+	chain->image = imageName;
+	chain->result = image;
+
+	if (!chain->vertexArray)
+		glGenVertexArrays(1, &chain->vertexArray);
+	while (chain->kernels.size() < 2 * effects.size()) {
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		chain->kernels.push_back(buffer);
+	}
+
+	// results are kept at half precision, so neither rounding to 8 bits nor
+	// clamping negative values (from Sobel filters) loses anything before
+	// the next effect
+	for (int i = 0; i < 2; i++)
+		InitializeFramebuffer(&chain->targets[i], image->width, image->height, GL_RGBA16F);
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	for (size_t i = 0; i < effects.size(); i++) {
+		MyTexture *source = chain->result;
+		MyFramebuffer *target = &chain->targets[i % 2];
+		GLuint *kernels = &chain->kernels[2 * i];
+
+		if (effects[i] >= 8 && effects[i] <= 11) {
+			// Gaussian blurs, horizontally and then vertically
+			InitializeFramebuffer(&chain->blurIntermediate, image->width, image->height,
+			                      GL_RGBA16F);
+			LoadKernel(kernels[0], blurTaps(effects[i], vec2(1.0f, 0.0f)), image);
+			LoadKernel(kernels[1], blurTaps(effects[i], vec2(0.0f, 1.0f)), image);
+			RenderPass(source, &chain->blurIntermediate, blurProgram, chain->vertexArray,
+			           kernels[0]);
+			RenderPass(&chain->blurIntermediate.texture, target, blurProgram,
+			           chain->vertexArray, kernels[1]);
+		} else if (effects[i] > 0 && effects[i] < EFFECT_PROGRAMS) {
+			LoadKernel(kernels[0], convolutionTaps(effects[i]), image);
+			RenderPass(source, target, passPrograms[effects[i]], chain->vertexArray,
+			           kernels[0]);
+		} else {
+			continue;
+		}
+		chain->result = &target->texture;
+	}
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	CheckGLErrors();
+	return chain->result;
+}
+
+// deallocate the chain's framebuffers and buffers
+void DestroyEffectChain(EffectChain *chain)
+{
+	for (int i = 0; i < 2; i++)
+		DestroyFramebuffer(&chain->targets[i]);
+	DestroyFramebuffer(&chain->blurIntermediate);
+	if (!chain->kernels.empty())
+		glDeleteBuffers(chain->kernels.size(), chain->kernels.data());
+	glDeleteVertexArrays(1, &chain->vertexArray);
+	*chain = EffectChain();
+}
+
 // --------------------------------------------------------------------------
 // Rendering function that draws our scene to the frame buffer
 
@@ -276,7 +560,7 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		glfwSetWindowShouldClose(window, GL_TRUE);
 
         if (key == GLFW_KEY_RIGHT) {
-            if (img == 6)
+            if (img == IMAGE_COUNT)
                 img = 1;
             else
                 img++;
@@ -285,7 +569,7 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 
         if (key == GLFW_KEY_LEFT) {
             if (img == 1)
-                img = 6;
+                img = IMAGE_COUNT;
             else
                 img--;
             newImg = true;
@@ -298,37 +582,37 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
             keyD = true;
 
         if (key == GLFW_KEY_ENTER)
-            effect = 0;
-
-        if (key == GLFW_KEY_1)
-            effect = 1;
-
-        if (key == GLFW_KEY_2)
-            effect = 2;
-
-        if (key == GLFW_KEY_3)
-            effect = 3;
-
-        if (key == GLFW_KEY_4)
-            effect = 4;
-
-        if (key == GLFW_KEY_5)
-            effect = 5;
+            effects.clear();
 
-        if (key == GLFW_KEY_6)
-            effect = 6;
-
-        if (key == GLFW_KEY_7)
-            effect = 7;
-
-        if (key == GLFW_KEY_8)
-            effect = 8;
+        // 1 to 9 are effects 1 to 9, 0 is effect 10 and G effect 11
+        int chosen = 0;
+        if (key >= GLFW_KEY_1 && key <= GLFW_KEY_9)
+            chosen = key - GLFW_KEY_0;
+        if (key == GLFW_KEY_0)
+            chosen = 10;
+        if (key == GLFW_KEY_G)
+            chosen = 11;
+
+        if (chosen) {
+            if (!(mods & GLFW_MOD_SHIFT))
+                effects.clear();
+            if (effects.size() < MAX_CHAINED_EFFECTS)
+                effects.push_back(chosen);
+        }
 
-        if (key == GLFW_KEY_9)
-            effect = 9;
+        if (chosen || key == GLFW_KEY_ENTER) {
+            cout << "Effects:";
+            for (size_t i = 0; i < effects.size(); i++)
+                cout << " " << effects[i];
+            cout << (effects.empty() ? " none" : "") << endl;
+        }
+    }
 
-        if (key == GLFW_KEY_0)
-            effect = 10;
+    // blur radius of effect 11, which repeats while the key is held
+    if (action != GLFW_RELEASE && (key == GLFW_KEY_MINUS || key == GLFW_KEY_EQUAL)) {
+        blurRadius += key == GLFW_KEY_EQUAL ? 1 : -1;
+        blurRadius = std::min(std::max(blurRadius, 1), MAX_BLUR_RADIUS);
+        cout << "Blur radius: " << blurRadius << endl;
     }
 
     if (action == GLFW_RELEASE) {
@@ -404,20 +688,33 @@ int main(int argc, char *argv[])
 	// query and print out information about our OpenGL environment
 	QueryGLVersion();
 
-	// call function to load and compile shader programs
-	GLuint program = InitializeShaders();
-	if (program == 0) {
+	// call function to load and compile shader programs: the one drawing
+	// the image on screen, and for each effect of fragment.glsl one that
+	// applies it to the whole image in a framebuffer
+	GLuint program = InitializeShaders("shaders/vertex.glsl", "shaders/fragment.glsl",
+	                                   "#define EFFECT 0\n");
+	GLuint passPrograms[EFFECT_PROGRAMS];
+	for (int i = 0; i < EFFECT_PROGRAMS; i++) {
+		passPrograms[i] = InitializeShaders("shaders/passVertex.glsl", "shaders/fragment.glsl",
+		                                    "#define EFFECT " + to_string(i) + "\n");
+		BindKernelBlock(passPrograms[i]);
+	}
+	GLuint blurProgram = InitializeShaders("shaders/passVertex.glsl", "shaders/blur.glsl");
+	BindKernelBlock(blurProgram);
+	if (program == 0 || count(passPrograms, passPrograms + EFFECT_PROGRAMS, 0u) > 0 ||
+	    blurProgram == 0) {
 		cout << "Program could not initialize shaders, TERMINATING" << endl;
 		return -1;
 	}
 
+	// the image with its effects applied, made again only when they change
+	EffectChain chain;
+
         vector<vec2> points;
         vector<vec2> texCoords;
 
-        MyTexture texture;
-        string fileName = "images/image1-mandrill.png";
-
-        cout << InitializeTexture(&texture, fileName.c_str(), GL_TEXTURE_2D);
+        TextureCache textures(TEXTURE_BUDGET);
+        newImg = true;
 
 	// call function to create and fill buffers with geometry data
 	Geometry geometry;
@@ -431,8 +728,6 @@ int main(int argc, char *argv[])
 	// float timeElapsed = 0.f;
 	// GLint timeLocation = glGetUniformLocation(program, "time");
         GLint transformLoc = glGetUniformLocation(program, "transform");
-        GLint effectLoc = glGetUniformLocation(program, "effect");
-        GLint dimensionsLoc = glGetUniformLocation(program, "imgDimensions");
 
 	// run an event-triggered main loop
 	while (!glfwWindowShouldClose(window))
@@ -446,22 +741,13 @@ int main(int argc, char *argv[])
                 trans = rotate(trans,
                         radians(theta), glm::vec3(0.0, 0.0, 1.0));
 
-                glUseProgram(program);
-                glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
-                glUniform1i(effectLoc, effect);
-                glUniform2f(dimensionsLoc, (float)texture.width, (float)texture.height);
-
-                switch(img) {
-                    case 1: fileName = "images/image1-mandrill.png"; break;
-                    case 2: fileName = "images/image2-uclogo.png"; break;
-                    case 3: fileName = "images/image3-aerial.jpg"; break;
-                    case 4: fileName = "images/image4-thirsk.jpg"; break;
-                    case 5: fileName = "images/image5-pattern.png"; break;
-                    case 6: fileName = "images/city.jpg"; break;
-                }
-
+                // the image is shown once it has loaded, and its neighbours
+                // are loaded after it
+                UpdateTextureCache(&textures);
+                MyTexture *texture = GetTexture(&textures, IMAGE_FILES[img - 1]);
                 if (newImg) {
-                    InitializeTexture(&texture, fileName.c_str(), GL_TEXTURE_2D);
+                    PrefetchTexture(&textures, IMAGE_FILES[img % IMAGE_COUNT]);
+                    PrefetchTexture(&textures, IMAGE_FILES[(img + IMAGE_COUNT - 2) % IMAGE_COUNT]);
                     newImg = false;
                 }
 
@@ -469,11 +755,27 @@ int main(int argc, char *argv[])
                 updateRotation();
 
 
-                generateImage(&points, &texCoords, texture.width, texture.height);
+                if (!texture) {
+                    // nothing to draw until the first image has loaded
+                    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    glfwSwapBuffers(window);
+                    glfwPollEvents();
+                    continue;
+                }
+
+                generateImage(&points, &texCoords, texture->width, texture->height);
                 LoadGeometry(&geometry, points.data(),
                              texCoords.data(), points.size());
 
-                glBindTexture(GL_TEXTURE_2D, texture.textureID);
+                // effects are applied to the image once, and the result is
+                // drawn with the view transform every frame
+                MyTexture *shown = ApplyEffects(&chain, texture, textures.shown, effects,
+                                                passPrograms, blurProgram);
+
+                glUseProgram(program);
+                glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
+                glBindTexture(GL_TEXTURE_2D, shown->textureID);
 
 		// call function to draw our scene
 		RenderScene(&geometry, program);
@@ -486,8 +788,13 @@ int main(int argc, char *argv[])
 
 	// clean up allocated resources before exit
 	DestroyGeometry(&geometry);
+	DestroyEffectChain(&chain);
+	DestroyTextureCache(&textures);
 	glUseProgram(0);
 	glDeleteProgram(program);
+	for (int i = 0; i < EFFECT_PROGRAMS; i++)
+		glDeleteProgram(passPrograms[i]);
+	glDeleteProgram(blurProgram);
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
@@ -561,14 +868,21 @@ string LoadSource(const string &filename)
 	return source;
 }
 
-// creates and returns a shader object compiled from the given source
-GLuint CompileShader(GLenum shaderType, const string &source)
+// creates and returns a shader object compiled from the given source, with
+// defines (lines of "#define NAME value") added after its #version line so
+// that one source can be compiled into specialized variants
+GLuint CompileShader(GLenum shaderType, const string &source, const string &defines)
 {
 	// allocate shader object name
 	GLuint shaderObject = glCreateShader(shaderType);
 
+	string specialized = source;
+	size_t version = specialized.find("#version");
+	size_t line = version == string::npos ? 0 : specialized.find('\n', version) + 1;
+	specialized.insert(line, defines);
+
 	// try compiling the source as a shader of the given type
-	const GLchar *source_ptr = source.c_str();
+	const GLchar *source_ptr = specialized.c_str();
 	glShaderSource(shaderObject, 1, &source_ptr, 0);
 	glCompileShader(shaderObject);
 
@@ -582,7 +896,7 @@ GLuint CompileShader(GLenum shaderType, const string &source)
 		string info(length, ' ');
 		glGetShaderInfoLog(shaderObject, info.length(), &length, &info[0]);
 		cout << "ERROR compiling shader:" << endl << endl;
-		cout << source << endl;
+		cout << specialized << endl;
 		cout << info << endl;
 	}
 
@@ -0,0 +1,58 @@
+#include "framebuffer.h"
+#include <iostream>
+
+using namespace std;
+
+MyFramebuffer::MyFramebuffer() : framebufferID(0), format(0)
+	{}
+
+bool InitializeFramebuffer(MyFramebuffer *framebuffer, int width, int height, GLenum format)
+{
+	if (framebuffer->framebufferID && framebuffer->texture.width == width &&
+	    framebuffer->texture.height == height && framebuffer->format == format)
+		return true;
+
+	DestroyFramebuffer(framebuffer);
+	framebuffer->format = format;
+
+	// colour texture, filtered linearly so passes can sample between texels
+	MyTexture *texture = &framebuffer->texture;
+	texture->target = GL_TEXTURE_2D;
+	texture->width = width;
+	texture->height = height;
+	glGenTextures(1, &texture->textureID);
+	glBindTexture(texture->target, texture->textureID);
+	glTexImage2D(texture->target, 0, format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexParameteri(texture->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(texture->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(texture->target, 0);
+
+	glGenFramebuffers(1, &framebuffer->framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture->target,
+	                       texture->textureID, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		cout << "ERROR: Framebuffer of " << width << "x" << height
+		     << " is incomplete (0x" << hex << status << dec << ")" << endl;
+		return false;
+	}
+	return true;
+}
+
+// deallocate framebuffer-related objects
+void DestroyFramebuffer(MyFramebuffer *framebuffer)
+{
+	if (framebuffer->framebufferID) {
+		glDeleteFramebuffers(1, &framebuffer->framebufferID);
+		framebuffer->framebufferID = 0;
+	}
+	if (framebuffer->texture.textureID) {
+		DestroyTexture(&framebuffer->texture);
+		framebuffer->texture = MyTexture();
+	}
+}
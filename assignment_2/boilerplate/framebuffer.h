@@ -0,0 +1,26 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "texture.h"
+
+// --------------------------------------------------------------------------
+// Functions to set up OpenGL framebuffers for rendering into a texture
+
+struct MyFramebuffer
+{
+	GLuint framebufferID;
+	MyTexture texture;	// colour attachment, sampled by later passes
+	GLenum format;
+
+	// initialize object names to zero (OpenGL reserved value)
+	MyFramebuffer();
+};
+
+// (re)creates the framebuffer with a width x height texture of the given
+// internal format; does nothing if it already has that size and format
+bool InitializeFramebuffer(MyFramebuffer *framebuffer, int width, int height,
+                           GLenum format = GL_RGBA8);
+
+// deallocate framebuffer-related objects
+void DestroyFramebuffer(MyFramebuffer *framebuffer);
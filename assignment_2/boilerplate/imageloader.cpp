@@ -0,0 +1,104 @@
+#include "imageloader.h"
+#include <algorithm>
+#include <stb/stb_image.h>
+
+using namespace std;
+
+DecodedImage::DecodedImage() : width(0), height(0), numComponents(0), pixels(0)
+	{}
+
+ImageLoader::ImageLoader() : stopping(false)
+	{}
+
+static void DecodeImages(ImageLoader *loader)
+{
+	unique_lock<mutex> lock(loader->mutex);
+	for (;;) {
+		loader->wake.wait(lock, [loader] { return loader->stopping || !loader->requests.empty(); });
+		if (loader->stopping)
+			return;
+
+		DecodedImage image;
+		image.filename = loader->requests.front();
+		loader->requests.pop_front();
+
+		lock.unlock();
+		image.pixels = stbi_load(image.filename.c_str(), &image.width, &image.height,
+		                         &image.numComponents, 0);
+		lock.lock();
+
+		loader->decoded.push_back(image);
+	}
+}
+
+void StartImageLoader(ImageLoader *loader, int threads)
+{
+	if (threads <= 0)
+		threads = std::max((int)thread::hardware_concurrency() - 1, 1);
+
+	// textures are drawn with their first row at the bottom; the flag is
+	// global to stb_image, so it is set before any worker reads it
+	stbi_set_flip_vertically_on_load(true);
+
+	loader->stopping = false;
+	for (int i = 0; i < threads; i++)
+		loader->workers.push_back(thread(DecodeImages, loader));
+}
+
+void RequestImage(ImageLoader *loader, const string &filename, bool urgent)
+{
+	{
+		lock_guard<mutex> lock(loader->mutex);
+		if (urgent)
+			loader->requests.push_front(filename);
+		else
+			loader->requests.push_back(filename);
+	}
+	loader->wake.notify_one();
+}
+
+void PromoteImage(ImageLoader *loader, const string &filename)
+{
+	lock_guard<mutex> lock(loader->mutex);
+	deque<string>::iterator it = find(loader->requests.begin(), loader->requests.end(), filename);
+	if (it != loader->requests.end()) {
+		loader->requests.erase(it);
+		loader->requests.push_front(filename);
+	}
+}
+
+bool TakeDecodedImage(ImageLoader *loader, DecodedImage *image)
+{
+	lock_guard<mutex> lock(loader->mutex);
+	if (loader->decoded.empty())
+		return false;
+
+	*image = loader->decoded.front();
+	loader->decoded.erase(loader->decoded.begin());
+	return true;
+}
+
+void FreeDecodedImage(DecodedImage *image)
+{
+	if (image->pixels)
+		stbi_image_free(image->pixels);
+	image->pixels = 0;
+}
+
+void StopImageLoader(ImageLoader *loader)
+{
+	{
+		lock_guard<mutex> lock(loader->mutex);
+		loader->stopping = true;
+		loader->requests.clear();
+	}
+	loader->wake.notify_all();
+
+	for (size_t i = 0; i < loader->workers.size(); i++)
+		loader->workers[i].join();
+	loader->workers.clear();
+
+	for (size_t i = 0; i < loader->decoded.size(); i++)
+		FreeDecodedImage(&loader->decoded[i]);
+	loader->decoded.clear();
+}
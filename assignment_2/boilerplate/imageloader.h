@@ -0,0 +1,53 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Pool of worker threads decoding image files into pixels, so the render
+// thread never waits on stb_image. Requests are decoded in order, except
+// that urgent ones (the image about to be shown) jump the queue.
+
+struct DecodedImage
+{
+	std::string filename;
+	int width;
+	int height;
+	int numComponents;
+	unsigned char *pixels;	// rows bottom first, tightly packed; 0 on failure
+
+	DecodedImage();
+};
+
+struct ImageLoader
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::string> requests;
+	std::vector<DecodedImage> decoded;
+	bool stopping;
+
+	ImageLoader();
+};
+
+// starts the workers, one per core but one, and at least one
+void StartImageLoader(ImageLoader *loader, int threads = 0);
+
+// queues filename to be decoded, at the front if urgent
+void RequestImage(ImageLoader *loader, const std::string &filename, bool urgent = false);
+
+// moves filename to the front of the queue if it is still waiting there
+void PromoteImage(ImageLoader *loader, const std::string &filename);
+
+// takes the next decoded image, returning false if there is none yet. Its
+// pixels must be freed with FreeDecodedImage.
+bool TakeDecodedImage(ImageLoader *loader, DecodedImage *image);
+
+void FreeDecodedImage(DecodedImage *image);
+
+// finishes the images being decoded, drops the rest and joins the workers
+void StopImageLoader(ImageLoader *loader);
@@ -37,56 +37,66 @@ MyTexture::MyTexture() : textureID(0), target(0), width(0), height(0)
 
 bool InitializeTexture(MyTexture* texture, const char* filename, GLuint target)
 {
-	int numComponents;
+	int width, height, numComponents;
 	stbi_set_flip_vertically_on_load(true);
-	unsigned char *data = stbi_load(filename, &texture->width, &texture->height, &numComponents, 0);
+	unsigned char *data = stbi_load(filename, &width, &height, &numComponents, 0);
 	if (data != nullptr)
 	{
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);		//Set alignment to be 1
-
-		texture->target = target;
-		glGenTextures(1, &texture->textureID);
-		glBindTexture(texture->target, texture->textureID);
-		GLuint format = GL_RGB;
-		switch(numComponents)
-		{
-			case 4:
-				format = GL_RGBA;
-				break;
-			case 3:
-				format = GL_RGB;
-				break;
-			case 2:
-				format = GL_RG;
-				break;
-			case 1:
-				format = GL_RED;
-				break;
-			default:
-				cout << "Invalid Texture Format" << endl;
-				break;
-		};
-		glTexImage2D(texture->target, 0, format, texture->width,
-                        texture->height, 0, format, GL_UNSIGNED_BYTE, data);
-
-		// Note: Only wrapping modes supported for GL_TEXTURE_RECTANGLE when defining
-		// GL_TEXTURE_WRAP are GL_CLAMP_TO_EDGE or GL_CLAMP_TO_BORDER
-		glTexParameteri(texture->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(texture->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(texture->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// Clean up
-		glBindTexture(texture->target, 0);
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
+		bool loaded = InitializeTexture(texture, width, height, numComponents, data, target);
 		stbi_image_free(data);
 
-		return !CheckGLErrors( (string("Loading texture: ")+filename).c_str() );
+		return loaded && !CheckGLErrors( (string("Loading texture: ")+filename).c_str() );
 	}
 
 	return true; //error
 }
 
+bool InitializeTexture(MyTexture* texture, int width, int height, int numComponents,
+                       const void* data, GLuint target)
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);		//Set alignment to be 1
+
+	texture->target = target;
+	texture->width = width;
+	texture->height = height;
+	glGenTextures(1, &texture->textureID);
+	glBindTexture(texture->target, texture->textureID);
+	GLuint format = GL_RGB;
+	switch(numComponents)
+	{
+		case 4:
+			format = GL_RGBA;
+			break;
+		case 3:
+			format = GL_RGB;
+			break;
+		case 2:
+			format = GL_RG;
+			break;
+		case 1:
+			format = GL_RED;
+			break;
+		default:
+			cout << "Invalid Texture Format" << endl;
+			break;
+	};
+	glTexImage2D(texture->target, 0, format, texture->width,
+                texture->height, 0, format, GL_UNSIGNED_BYTE, data);
+
+	// Note: Only wrapping modes supported for GL_TEXTURE_RECTANGLE when defining
+	// GL_TEXTURE_WRAP are GL_CLAMP_TO_EDGE or GL_CLAMP_TO_BORDER
+	glTexParameteri(texture->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(texture->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Clean up
+	glBindTexture(texture->target, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
+
+	return !CheckGLErrors("Creating texture: ");
+}
+
 // deallocate texture-related objects
 void DestroyTexture(MyTexture *texture)
 {
@@ -18,5 +18,11 @@ struct MyTexture
 
 bool InitializeTexture(MyTexture* texture, const char* filename, GLuint target = GL_TEXTURE_2D);
 
+// creates the texture from decoded pixels with the given number of 8-bit
+// components, rows packed tightly; data is an offset into the buffer bound
+// to GL_PIXEL_UNPACK_BUFFER, if one is
+bool InitializeTexture(MyTexture* texture, int width, int height, int numComponents,
+                       const void* data, GLuint target = GL_TEXTURE_2D);
+
 // deallocate texture-related objects
 void DestroyTexture(MyTexture *texture);
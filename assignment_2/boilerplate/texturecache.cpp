@@ -0,0 +1,187 @@
+#include "texturecache.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+CachedTexture::CachedTexture() : ready(false), urgent(false), failed(false)
+	{}
+
+PixelBuffer::PixelBuffer() : buffer(0), size(0), fence(0)
+	{}
+
+TextureCache::TextureCache(size_t budget) : bytes(0), budget(budget)
+	{}
+
+size_t TextureBytes(const MyTexture &texture)
+{
+	return size_t(texture.width) * texture.height * 4;
+}
+
+// evicts least recently used textures until the cache fits its budget,
+// keeping the most recently used one, the one shown, keep, and any that
+// are still loading
+static void Evict(TextureCache *cache, const string &keep)
+{
+	list<string>::iterator it = cache->order.end();
+	while (cache->bytes > cache->budget && it != cache->order.begin()) {
+		--it;
+		map<string, CachedTexture>::iterator texture = cache->textures.find(*it);
+		if (it == cache->order.begin() || *it == keep || *it == cache->shown ||
+		    !texture->second.ready)
+			continue;
+
+		cache->bytes -= TextureBytes(texture->second.texture);
+		DestroyTexture(&texture->second.texture);
+		cache->textures.erase(texture);
+		it = cache->order.erase(it);
+	}
+}
+
+// adds an entry for filename at position in the order and queues it
+static void Request(TextureCache *cache, const string &filename, list<string>::iterator position,
+                    bool urgent)
+{
+	if (cache->loader.workers.empty())
+		StartImageLoader(&cache->loader);
+
+	cache->textures[filename].urgent = urgent;
+	cache->order.insert(position, filename);
+	RequestImage(&cache->loader, filename, urgent);
+}
+
+MyTexture *GetTexture(TextureCache *cache, const string &filename)
+{
+	map<string, CachedTexture>::iterator it = cache->textures.find(filename);
+	if (it == cache->textures.end()) {
+		Request(cache, filename, cache->order.begin(), true);
+	} else {
+		if (cache->order.front() != filename) {
+			cache->order.remove(filename);
+			cache->order.push_front(filename);
+		}
+		// a prefetch still waiting for a worker goes to the front
+		if (!it->second.urgent && !it->second.failed) {
+			it->second.urgent = true;
+			PromoteImage(&cache->loader, filename);
+		}
+		if (it->second.ready) {
+			cache->shown = filename;
+			return &it->second.texture;
+		}
+	}
+
+	it = cache->textures.find(cache->shown);
+	return it != cache->textures.end() ? &it->second.texture : 0;
+}
+
+bool PrefetchTexture(TextureCache *cache, const string &filename)
+{
+	if (cache->textures.count(filename))
+		return false;
+
+	list<string>::iterator position = cache->order.begin();
+	if (position != cache->order.end())
+		++position;
+	Request(cache, filename, position, false);
+	return true;
+}
+
+// --------------------------------------------------------------------------
+
+// copies image into buffer and starts uploading it into texture from there
+static void Upload(PixelBuffer *buffer, const DecodedImage &image, MyTexture *texture)
+{
+	size_t size = size_t(image.width) * image.height * image.numComponents;
+
+	if (!buffer->buffer)
+		glGenBuffers(1, &buffer->buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->buffer);
+	if (buffer->size < size) {
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
+		buffer->size = size;
+	}
+
+	// the buffer's last upload has finished, so it is written without
+	// waiting for the GPU
+	void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT |
+	                                GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (mapped) {
+		memcpy(mapped, image.pixels, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		InitializeTexture(texture, image.width, image.height, image.numComponents, 0);
+	} else {
+		// without a mapping the pixels are uploaded directly
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		InitializeTexture(texture, image.width, image.height, image.numComponents,
+		                  image.pixels);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	buffer->filename = image.filename;
+	glFlush();
+}
+
+void UpdateTextureCache(TextureCache *cache)
+{
+	PixelBuffer *idle = 0;
+	for (int i = 0; i < PIXEL_BUFFERS; i++) {
+		PixelBuffer *buffer = &cache->pixelBuffers[i];
+		if (buffer->fence) {
+			GLenum status = glClientWaitSync(buffer->fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				continue;
+
+			glDeleteSync(buffer->fence);
+			buffer->fence = 0;
+			cache->textures[buffer->filename].ready = true;
+		}
+		if (!idle)
+			idle = buffer;
+	}
+
+	// one upload a frame, so no frame copies more than one image
+	DecodedImage image;
+	if (!idle || !TakeDecodedImage(&cache->loader, &image))
+		return;
+
+	// the entry is kept, so the file is neither decoded nor reported again
+	if (!image.pixels) {
+		cout << "ERROR: Could not load image " << image.filename << endl;
+		cache->textures[image.filename].failed = true;
+		return;
+	}
+
+	MyTexture *texture = &cache->textures[image.filename].texture;
+	Upload(idle, image, texture);
+	FreeDecodedImage(&image);
+
+	cache->bytes += TextureBytes(*texture);
+	Evict(cache, image.filename);
+}
+
+// deallocate every cached texture and buffer, and stop the workers
+void DestroyTextureCache(TextureCache *cache)
+{
+	StopImageLoader(&cache->loader);
+
+	for (int i = 0; i < PIXEL_BUFFERS; i++) {
+		PixelBuffer *buffer = &cache->pixelBuffers[i];
+		if (buffer->fence)
+			glDeleteSync(buffer->fence);
+		if (buffer->buffer)
+			glDeleteBuffers(1, &buffer->buffer);
+		*buffer = PixelBuffer();
+	}
+
+	for (map<string, CachedTexture>::iterator it = cache->textures.begin();
+	     it != cache->textures.end(); ++it) {
+		if (it->second.texture.textureID)
+			DestroyTexture(&it->second.texture);
+	}
+	cache->textures.clear();
+	cache->order.clear();
+	cache->shown.clear();
+	cache->bytes = 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <list>
+#include <map>
+#include <string>
+
+#include "texture.h"
+#include "imageloader.h"
+
+// --------------------------------------------------------------------------
+// Cache of image textures keyed by file name, so switching back to an image
+// does not decode and upload it again. Textures are evicted least recently
+// used first once their memory passes the budget.
+//
+// Nothing is loaded on the render thread: images are decoded by a pool of
+// workers, and their pixels are copied into one of a few pixel unpack
+// buffers kept for the life of the cache, which the driver uploads to the
+// texture in the background. A fence after each upload says when the buffer
+// may be reused and the texture drawn; until then the last texture shown is
+// drawn instead.
+
+const int PIXEL_BUFFERS = 2;
+
+struct CachedTexture
+{
+	MyTexture texture;
+	bool ready;		// uploaded and safe to draw
+	bool urgent;	// asked for to be shown, not just prefetched
+	bool failed;	// could not be decoded, and is not tried again
+
+	CachedTexture();
+};
+
+struct PixelBuffer
+{
+	GLuint buffer;
+	size_t size;
+	GLsync fence;			// set while an upload from the buffer is in flight
+	std::string filename;	// the image being uploaded
+
+	PixelBuffer();
+};
+
+struct TextureCache
+{
+	// every image asked for, including those still decoding or uploading
+	std::map<std::string, CachedTexture> textures;
+	std::list<std::string> order;	// most recently used first
+	std::string shown;				// the last texture GetTexture returned
+	size_t bytes;
+	size_t budget;
+
+	ImageLoader loader;
+	PixelBuffer pixelBuffers[PIXEL_BUFFERS];
+
+	TextureCache(size_t budget);
+};
+
+// GPU memory of a texture, counting 4 bytes per texel as drivers store RGB
+// images padded to RGBA
+size_t TextureBytes(const MyTexture &texture);
+
+// Returns the texture of filename, marked as the most recently used, if it
+// is ready to draw. Otherwise it is queued to be decoded ahead of any
+// prefetches, and the last texture returned is given again; 0 if there has
+// not been one. An image that failed to decode is reported once and then
+// treated as never ready.
+MyTexture *GetTexture(TextureCache *cache, const std::string &filename);
+
+// queues filename to be loaded ahead of time if it is not cached, as the
+// next most recently used after the current one so it neither evicts nor
+// outlives it; returns false if it was already cached
+bool PrefetchTexture(TextureCache *cache, const std::string &filename);
+
+// Called once a frame: marks finished uploads ready, and starts uploading
+// the next decoded image if a pixel buffer is free. Never waits on the GPU
+// or the workers.
+void UpdateTextureCache(TextureCache *cache);
+
+// deallocate every cached texture and buffer, and stop the workers
+void DestroyTextureCache(TextureCache *cache);
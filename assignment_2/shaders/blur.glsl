@@ -0,0 +1,36 @@
+// ==========================================================================
+// Fragment program for one pass of a separable Gaussian blur
+//
+// A 2D Gaussian is the product of two 1D ones, so the image is blurred
+// horizontally into a framebuffer and that is blurred vertically, taking
+// 2r + 1 weights per pixel in each pass instead of (2r + 1)^2. Neighbouring
+// weights are merged into single taps placed between their texels, which
+// linear filtering splits back into the two weights, halving the fetches
+// again. The main program works the taps of each pass out once and uploads
+// them in the Kernel block.
+// ==========================================================================
+#version 410
+
+// must match MAX_KERNEL_TAPS in the main program
+#define MAX_TAPS 65
+
+in vec2 TexCoord;
+
+out vec4 FragmentColour;
+
+uniform sampler2D image;
+
+// offset of each tap in texture coordinates (xy) and its weight (z)
+layout(std140) uniform Kernel
+{
+    vec4 taps[MAX_TAPS];
+    int tapCount;
+};
+
+void main(void)
+{
+    vec4 sum = vec4(0.0);
+    for (int i = 0; i < tapCount; i++)
+        sum += texture(image, TexCoord + taps[i].xy) * taps[i].z;
+    FragmentColour = sum;
+}
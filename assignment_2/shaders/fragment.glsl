@@ -17,129 +17,52 @@ in vec2 TexCoord;
 out vec4 FragmentColour;
 
 uniform sampler2D image;
-uniform int effect;
-uniform vec2 imgDimensions;
 
-void main(void)
+// The main program compiles one variant of this shader per effect, with
+// EFFECT defined to its number, so each holds only the code it needs:
+//  0: original image           4: sepia
+//  1, 2, 3: luminance          5, 6, 7: 3x3 convolution (Sobel, unsharp mask)
+// Effects 1 to 7 are applied to the whole image in a framebuffer, and
+// Gaussian blurs (effects 8 to 11), which are separable, in two passes of
+// blur.glsl; variant 0 then draws the result on screen.
+#ifndef EFFECT
+#define EFFECT 0
+#endif
+
+#if EFFECT >= 5 && EFFECT <= 7
+// must match MAX_KERNEL_TAPS in the main program
+#define MAX_TAPS 65
+
+// the 3x3 kernel of the effect, worked out by the main program when the
+// effect or image changes: offset of each tap in texture coordinates (xy)
+// and its weight (z)
+layout(std140) uniform Kernel
 {
-    // Colour and texture variables
-    vec3 lum1 = vec3(0.333, 0.333, 0.333);
-    vec3 lum2 = vec3(0.299, 0.587, 0.114);
-    vec3 lum3 = vec3(0.213, 0.715, 0.072);
-    vec3 sepia = vec3(0.44, 0.26, 0.08);
+    vec4 taps[MAX_TAPS];
+    int tapCount;
+};
+#endif
 
+void main(void)
+{
+#if EFFECT == 1
+    FragmentColour = vec4(dot(vec3(0.333, 0.333, 0.333), texture(image, TexCoord).rgb));
+#elif EFFECT == 2
+    FragmentColour = vec4(dot(vec3(0.299, 0.587, 0.114), texture(image, TexCoord).rgb));
+#elif EFFECT == 3
+    FragmentColour = vec4(dot(vec3(0.213, 0.715, 0.072), texture(image, TexCoord).rgb));
+#elif EFFECT == 4
     vec4 origColour = texture(image, TexCoord);
-    float greyscale1 = dot(lum1, origColour.rgb);
-    float greyscale2 = dot(lum2, origColour.rgb);
-    float greyscale3 = dot(lum3, origColour.rgb);
-    vec3 sepiaTone = vec3(greyscale2) * sepia;
-
-    // Edge Effect Variables
-    float w = 1.0 / imgDimensions.x;
-    float h = 1.0 / imgDimensions.y;
-
-    vec2 kernel3[9];
-    vec2 kernel5[25];
-    vec2 kernel7[49];
-
+    vec3 sepiaTone = dot(vec3(0.299, 0.587, 0.114), origColour.rgb) * vec3(0.44, 0.26, 0.08);
+    origColour.rgb = mix(sepiaTone, origColour.rgb, 0.75);
+    FragmentColour = origColour;
+#elif EFFECT >= 5 && EFFECT <= 7
     vec4 appliedFilter = vec4(0.0);
-
-    float verticalSobel[9] = float[9](1.0f, 0.0f, -1.0f,
-                                      2.0f, 0.0f, -2.0f,
-                                      1.0f, 0.0f, -1.0f);
-
-    float horizontalSobel[9] = float[9](-1.0f, -2.0f, -1.0f,
-                                        0.0f, 0.0f, 0.0f,
-                                        1.0f, 2.0f, 1.0f);
-
-    float unsharpMask[9] = float[9](0.0f, -1.0f, 0.0f,
-                                    -1.0f, 5.0f, -1.0f,
-                                    0.0f, -1.0f, 0.0f);
-
-    float gaussian3[3] = float[3](0.2, 0.6, 0.2);
-    float gaussian5[5] = float[5](0.06, 0.24, 0.4, 0.24, 0.06);
-    float gaussian7[7] = float[7](0.03, 0.11, 0.22, 0.28, 0.22, 0.11, 0.03);
-
-    float gaussMat3[9];
-    float gaussMat5[25];
-    float gaussMat7[49];
-
-    int k = 0;
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            kernel3[k] = vec2(j * w - w, h - i * h);
-            gaussMat3[k] = gaussian3[i] * gaussian3[j];
-            k++;
-        }
-    }
-
-    k = 0;
-    for (int i = 0; i < 5; i++) {
-        for (int j = 0; j < 5; j++) {
-            kernel5[k] = vec2(j * w - 2 * w, 2 * h - i * h);
-            gaussMat5[k] = gaussian5[i] * gaussian5[j];
-            k++;
-        }
-    }
-
-    k = 0;
-    for (int i = 0; i < 7; i++) {
-        for (int j = 0; j < 7; j++) {
-            kernel7[k] = vec2(j * w - 3 * w, 3 * h - i * h);
-            gaussMat7[k] = gaussian7[i] * gaussian7[j];
-            k++;
-        }
-    }
-
-    // Effects
-    switch(effect) {
-        case 0:
-            FragmentColour = origColour; break;
-        case 1:
-            FragmentColour = vec4(greyscale1); break;
-        case 2:
-            FragmentColour = vec4(greyscale2); break;
-        case 3:
-            FragmentColour = vec4(greyscale3); break;
-        case 4:
-            origColour.rgb = mix(sepiaTone, origColour.rgb, 0.75);
-            FragmentColour =  origColour;
-            break;
-        case 5:
-            for (int i = 0; i < 9; i++) {
-                appliedFilter += texture(image, TexCoord + kernel3[i]) * verticalSobel[i];
-            }
-            FragmentColour = appliedFilter;
-            break;
-        case 6:
-            for (int i = 0; i < 9; i++) {
-                appliedFilter += texture(image, TexCoord + kernel3[i]) * horizontalSobel[i];
-            }
-            FragmentColour = appliedFilter;
-            break;
-        case 7:
-            for (int i = 0; i < 9; i++) {
-                appliedFilter += texture(image, TexCoord + kernel3[i]) * unsharpMask[i];
-            }
-            FragmentColour = appliedFilter;
-            break;
-        case 8:
-            for (int i = 0; i < 9; i++) {
-                appliedFilter += texture(image, TexCoord + kernel3[i]) * gaussMat3[i];
-            }
-            FragmentColour = appliedFilter;
-            break;
-        case 9:
-            for (int i = 0; i < 25; i++) {
-                appliedFilter += texture(image, TexCoord + kernel5[i]) * gaussMat5[i];
-            }
-            FragmentColour = appliedFilter;
-            break;
-        case 10:
-            for (int i = 0; i < 49; i++) {
-                appliedFilter += texture(image, TexCoord + kernel7[i]) * gaussMat7[i];
-            }
-            FragmentColour = appliedFilter;
-            break;
+    for (int i = 0; i < tapCount; i++) {
+        appliedFilter += texture(image, TexCoord + taps[i].xy) * taps[i].z;
     }
+    FragmentColour = appliedFilter;
+#else
+    FragmentColour = texture(image, TexCoord);
+#endif
 }
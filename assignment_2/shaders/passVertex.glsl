@@ -0,0 +1,18 @@
+// ==========================================================================
+// Vertex program for passes that render a whole image into a framebuffer
+//
+// Draws one triangle covering the viewport, made from gl_VertexID alone so
+// no vertex buffers are needed.
+// ==========================================================================
+#version 410
+
+// texture coordinate of the image texel under the fragment
+out vec2 TexCoord;
+
+void main()
+{
+    // vertices at (-1, -1), (3, -1) and (-1, 3) cover the viewport
+    vec2 corner = vec2((gl_VertexID & 1) * 2, (gl_VertexID & 2));
+    TexCoord = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,186 @@
+// ==========================================================================
+// Curve Flattening Benchmark for Assignment 3
+//
+// Flattens every glyph of each font in fonts/ on the CPU, comparing the
+// adaptive SIMD flattener in Flatten.h against a scalar version of the same
+// step counts and against even sampling at 64 steps per segment, which is
+// what the tessellation shaders used to do. Each variant is run for a
+// number of timed repetitions, and the mean and standard deviation of the
+// time per font are reported with the number of points written.
+//
+// Build with "make bench", then run
+//     ./a3_bench.out [pixels per EM] [tolerance in pixels] [repetitions]
+// ==========================================================================
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "GlyphExtractor.h"
+#include "Flatten.h"
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+// Benchmark Parameters
+
+struct BenchConfig {
+    float pixelsPerEm;
+    float tolerance;
+    int repetitions;
+    BenchConfig(): pixelsPerEm(64), tolerance(0.25f), repetitions(25) {}
+};
+
+struct VariantResult {
+    string font;
+    string variant;
+    vector<double> msPerFont;
+    size_t points;
+    VariantResult(string f, string v): font(f), variant(v), points(0) {}
+};
+
+typedef chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// --------------------------------------------------------------------------
+// Baselines
+
+vec2 evaluate(const MySegment &s, float t) {
+    float x[4], y[4];
+    for (unsigned int i = 0; i <= s.degree; i++) {
+        x[i] = s.x[i];
+        y[i] = s.y[i];
+    }
+    for (unsigned int n = s.degree; n > 0; n--) {
+        for (unsigned int i = 0; i < n; i++) {
+            x[i] += (x[i + 1] - x[i]) * t;
+            y[i] += (y[i + 1] - y[i]) * t;
+        }
+    }
+    return vec2(x[0], y[0]);
+}
+
+// every segment, lines included, sampled at the same number of steps
+size_t flattenUniform(const vector<MyGlyph> &glyphs, int steps, vector<vec2> *out) {
+    size_t count = 0;
+    for (size_t g = 0; g < glyphs.size(); g++) {
+        for (size_t c = 0; c < glyphs[g].contours.size(); c++) {
+            const MyContour &contour = glyphs[g].contours[c];
+            for (size_t i = 0; i < contour.size(); i++) {
+                for (int j = (i == 0 ? 0 : 1); j <= steps; j++)
+                    (*out)[count++] = evaluate(contour[i], float(j) / steps);
+            }
+        }
+    }
+    return count;
+}
+
+// the adaptive step counts, evaluated one curve and one point at a time
+size_t flattenScalar(const vector<MyGlyph> &glyphs, float tolerance, vector<vec2> *out) {
+    size_t count = 0;
+    for (size_t g = 0; g < glyphs.size(); g++) {
+        for (size_t c = 0; c < glyphs[g].contours.size(); c++) {
+            const MyContour &contour = glyphs[g].contours[c];
+            if (!contour.empty())
+                (*out)[count++] = vec2(contour[0].x[0], contour[0].y[0]);
+            for (size_t i = 0; i < contour.size(); i++) {
+                if (contour[i].degree == 0)
+                    continue;
+                int steps = FlattenSteps(contour[i], tolerance);
+                for (int j = 1; j <= steps; j++)
+                    (*out)[count++] = evaluate(contour[i], float(j) / steps);
+            }
+        }
+    }
+    return count;
+}
+
+// --------------------------------------------------------------------------
+// Reporting
+
+void printResult(const VariantResult &r, size_t glyphs) {
+    double mean = 0;
+    for (size_t i = 0; i < r.msPerFont.size(); i++)
+        mean += r.msPerFont[i];
+    mean /= r.msPerFont.size();
+
+    double variance = 0;
+    for (size_t i = 0; i < r.msPerFont.size(); i++)
+        variance += (r.msPerFont[i] - mean) * (r.msPerFont[i] - mean);
+    variance /= r.msPerFont.size();
+
+    printf("%-32s %-10s %7zu %10.3f %10.4f %10zu\n", r.font.c_str(), r.variant.c_str(),
+           glyphs, mean, std::sqrt(variance), r.points);
+}
+
+// ==========================================================================
+// PROGRAM ENTRY POINT
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    if (argc > 1) config.pixelsPerEm = atof(argv[1]);
+    if (argc > 2) config.tolerance = atof(argv[2]);
+    if (argc > 3) config.repetitions = atoi(argv[3]);
+
+    const char *fonts[] = { "fonts/Inconsolata.otf", "fonts/AlexBrush-Regular.ttf",
+                            "fonts/Lora-Regular.ttf", "fonts/SourceSansPro-Regular.otf" };
+    float tolerance = config.tolerance / config.pixelsPerEm;
+
+    printf("%.1f pixels per EM, %.2f pixel tolerance, %d repetitions\n\n",
+           config.pixelsPerEm, config.tolerance, config.repetitions);
+    printf("%-32s %-10s %7s %10s %10s %10s\n", "font", "variant", "glyphs", "ms/font", "stddev", "points");
+
+    for (int f = 0; f < 4; f++) {
+        GlyphExtractor extractor;
+        if (!extractor.LoadFontFile(fonts[f]))
+            continue;
+
+        vector<int> codes = extractor.CharacterCodes();
+        vector<MyGlyph> glyphs;
+        size_t segments = 0;
+        size_t contours = 0;
+        for (size_t i = 0; i < codes.size(); i++) {
+            glyphs.push_back(extractor.ExtractGlyph(codes[i]));
+            for (size_t c = 0; c < glyphs.back().contours.size(); c++)
+                segments += glyphs.back().contours[c].size();
+            contours += glyphs.back().contours.size();
+        }
+
+        vector<vec2> points(segments * MAX_FLATTEN_STEPS + contours);
+        vector<Polyline> lines(contours);
+        FlattenArena arena(points.data(), points.size(), lines.data(), lines.size());
+
+        VariantResult simd(fonts[f], "simd");
+        VariantResult scalar(fonts[f], "scalar");
+        VariantResult uniform(fonts[f], "uniform64");
+        for (int rep = 0; rep < config.repetitions; rep++) {
+            Clock::time_point start = Clock::now();
+            arena.Reset();
+            for (size_t g = 0; g < glyphs.size(); g++)
+                FlattenGlyph(glyphs[g], tolerance, &arena);
+            simd.msPerFont.push_back(elapsedMs(start));
+            simd.points = arena.pointCount;
+
+            start = Clock::now();
+            scalar.points = flattenScalar(glyphs, tolerance, &points);
+            scalar.msPerFont.push_back(elapsedMs(start));
+
+            start = Clock::now();
+            uniform.points = flattenUniform(glyphs, 64, &points);
+            uniform.msPerFont.push_back(elapsedMs(start));
+        }
+
+        printResult(simd, glyphs.size());
+        printResult(scalar, glyphs.size());
+        printResult(uniform, glyphs.size());
+    }
+
+    return 0;
+}
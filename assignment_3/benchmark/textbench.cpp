@@ -0,0 +1,746 @@
+// ==========================================================================
+// Text Rendering Benchmark for Assignment 3
+//
+// Measures the font pipeline without a window:
+//  - glyph extraction per font, on one thread and on one per core
+//  - layout time per 1000 characters, for lines (TextLayout) and for
+//    wrapping a document (TextView)
+//  - control points and tessellated vertices drawn per frame
+//  - frame time of the three scrolling scenes (tessellated outlines,
+//    distance field text and the document view) at fixed scroll positions
+//
+// Frames are drawn with the program's own shaders into an offscreen
+// framebuffer the size of its window, in a headless EGL context; with Mesa,
+// LIBGL_ALWAYS_SOFTWARE=1 times the software renderer. Without EGL only the
+// CPU measurements are made.
+//
+// Build with "make textbench", then run
+//     ./a3_textbench.out [--json] [repetitions]
+// Results are printed as CSV (benchmark,font,case,value,unit), or as JSON
+// with --json, so runs can be compared for regressions.
+// ==========================================================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+
+#include "FontManager.h"
+#include "GlyphAtlas.h"
+#include "GlyphExtractor.h"
+#include "TextLayout.h"
+#include "TextView.h"
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+// Benchmark Parameters
+
+struct BenchConfig {
+    bool json;
+    int repetitions;
+    int width, height;
+    BenchConfig(): json(false), repetitions(20), width(512), height(512) {}
+};
+
+// the scenes and settings of the program
+const char *SCROLL_FONTS[] = { "fonts/Inconsolata.otf", "fonts/AlexBrush-Regular.ttf",
+                               "fonts/Lora-Regular.ttf" };
+const char *ALL_FONTS[] = { "fonts/Inconsolata.otf", "fonts/AlexBrush-Regular.ttf",
+                            "fonts/Lora-Regular.ttf", "fonts/SourceSansPro-Regular.otf" };
+const string SENTENCE = "The quick brown fox jumped over the lazy dog.";
+const float SENTENCE_SIZE = 0.85f;
+const float SENTENCE_POSITIONS[] = { 0.0f, 5.0f, 10.0f, 15.0f };
+const float DOCUMENT_POSITIONS[] = { 0.0f, 0.25f, 0.5f, 0.9f };  // of its height
+const int ATLAS_PIXELS_PER_EM = 48;
+const float ATLAS_RANGE = 4.0f;
+const float TOLERANCE = 0.25f;
+
+struct Result {
+    string benchmark;
+    string font;
+    string variant;
+    double value;
+    string unit;
+};
+
+vector<Result> results;
+
+void record(const string &benchmark, const string &font, const string &variant, double value,
+            const string &unit) {
+    Result r = { benchmark, font, variant, value, unit };
+    results.push_back(r);
+}
+
+typedef chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// the document of scene 5: a thousand numbered paragraphs of the sentence
+string generateDocument() {
+    string text;
+    for (int i = 1; i <= 1000; i++) {
+        text += to_string(i) + ".";
+        for (int j = 0; j <= i % 4; j++)
+            text += " " + SENTENCE;
+        text += "\n";
+    }
+    return text;
+}
+
+// --------------------------------------------------------------------------
+// CPU Benchmarks
+
+void benchExtraction(const BenchConfig &config) {
+    for (int f = 0; f < 4; f++) {
+        GlyphExtractor extractor;
+        if (!extractor.LoadFontFile(ALL_FONTS[f]))
+            continue;
+        vector<int> codes = extractor.CharacterCodes();
+
+        vector<GlyphOutline> outlines(codes.size());
+        double serial = 0.0, threaded = 0.0;
+        for (int rep = 0; rep < config.repetitions; rep++) {
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < codes.size(); i++)
+                extractor.ExtractOutline(codes[i], &outlines[i]);
+            serial += elapsedMs(start);
+
+            start = Clock::now();
+            ExtractOutlines(ALL_FONTS[f], codes, &outlines);
+            threaded += elapsedMs(start);
+        }
+
+        record("extract", ALL_FONTS[f], "glyphs", codes.size(), "count");
+        record("extract", ALL_FONTS[f], "serial", serial / config.repetitions, "ms");
+        record("extract", ALL_FONTS[f], "threaded", threaded / config.repetitions, "ms");
+    }
+}
+
+void benchLayout(const BenchConfig &config, FontManager &fonts, const GlyphAtlas *atlases,
+                 const string &document) {
+    // the paragraphs of the document, each a distinct line
+    vector<string> paragraphs;
+    for (size_t begin = 0; begin < document.size();) {
+        size_t end = document.find('\n', begin);
+        if (end == string::npos)
+            end = document.size();
+        paragraphs.push_back(document.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    double thousands = document.size() / 1000.0;
+
+    for (int f = 0; f < 3; f++) {
+        int face = fonts.LoadFont(SCROLL_FONTS[f]);
+        if (face < 0)
+            continue;
+
+        // a fresh layout each time, since finished lines are cached, but
+        // with the glyph outlines already loaded
+        double lines = 0.0;
+        for (int rep = 0; rep <= config.repetitions; rep++) {
+            TextLayout layout(fonts);
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < paragraphs.size(); i++)
+                layout.Layout(paragraphs[i], face, SENTENCE_SIZE);
+            if (rep > 0)
+                lines += elapsedMs(start);
+        }
+        record("layout", SCROLL_FONTS[f], "lines", lines / config.repetitions / thousands,
+               "ms/1k chars");
+
+        // wrapping the whole document, by scrolling a view to its end
+        double wrap = 0.0;
+        for (int rep = 0; rep < config.repetitions; rep++) {
+            TextView view(fonts, atlases[f], face, 0.08f, 1.9f, 0.1f, 32, 128);
+            view.SetText(document);
+            Clock::time_point start = Clock::now();
+            view.Update(1e9f, 2.0f, 4);
+            wrap += elapsedMs(start);
+        }
+        record("layout", SCROLL_FONTS[f], "wrap", wrap / config.repetitions / thousands,
+               "ms/1k chars");
+    }
+}
+
+// --------------------------------------------------------------------------
+// Headless OpenGL
+
+bool createContext() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) ||
+        !eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "ERROR: No EGL display, skipping the rendering benchmarks\n");
+        return false;
+    }
+
+    // no surface is needed, since frames go to a framebuffer object
+    const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig eglConfig;
+    EGLint configs = 0;
+    eglChooseConfig(display, configAttributes, &eglConfig, 1, &configs);
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, configs ? eglConfig : 0, EGL_NO_CONTEXT,
+                                          contextAttributes);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) ||
+        !gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        fprintf(stderr, "ERROR: No OpenGL 4.1 context, skipping the rendering benchmarks\n");
+        return false;
+    }
+
+    fprintf(stderr, "OpenGL %s, %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+    return true;
+}
+
+string loadSource(const string &filename) {
+    ifstream input(filename.c_str());
+    if (!input)
+        fprintf(stderr, "ERROR: Could not load shader source from file %s\n", filename.c_str());
+    return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+}
+
+// the shader compiled with "#define DEGREE degree" after its #version line,
+// or as it is for a degree of 0
+GLuint compileShader(GLenum type, string source, int degree = 0) {
+    if (degree > 0) {
+        size_t line = source.find('\n', source.find("#version"));
+        source.insert(line + 1, "#define DEGREE " + to_string(degree) + "\n");
+    }
+
+    GLuint shader = glCreateShader(type);
+    const GLchar *text = source.c_str();
+    glShaderSource(shader, 1, &text, 0);
+    glCompileShader(shader);
+
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE) {
+        char info[4096];
+        glGetShaderInfoLog(shader, sizeof(info), 0, info);
+        fprintf(stderr, "ERROR compiling shader:\n%s\n", info);
+    }
+    return shader;
+}
+
+GLuint linkProgram(const vector<GLuint> &shaders) {
+    GLuint program = glCreateProgram();
+    for (size_t i = 0; i < shaders.size(); i++) {
+        if (shaders[i])
+            glAttachShader(program, shaders[i]);
+    }
+    glLinkProgram(program);
+
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        char info[4096];
+        glGetProgramInfoLog(program, sizeof(info), 0, info);
+        fprintf(stderr, "ERROR linking shader program:\n%s\n", info);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Offscreen framebuffers the size of the window: one sample per pixel, for
+// analytic coverage and distance field text, and four, resolved into the
+// first, for multisampled curves.
+struct Framebuffers {
+    GLuint single, singleColour;
+    GLuint multi, multiColour;
+};
+
+Framebuffers createFramebuffers(int width, int height) {
+    Framebuffers fb;
+    glGenRenderbuffers(1, &fb.singleColour);
+    glBindRenderbuffer(GL_RENDERBUFFER, fb.singleColour);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &fb.multiColour);
+    glBindRenderbuffer(GL_RENDERBUFFER, fb.multiColour);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &fb.single);
+    glBindFramebuffer(GL_FRAMEBUFFER, fb.single);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              fb.singleColour);
+    glGenFramebuffers(1, &fb.multi);
+    glBindFramebuffer(GL_FRAMEBUFFER, fb.multi);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              fb.multiColour);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return fb;
+}
+
+// mean time of a frame over repetitions, after one to warm up; glFinish
+// makes the time include the GPU's work
+double timeFrames(int repetitions, const function<void()> &frame) {
+    frame();
+    glFinish();
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < repetitions; i++)
+        frame();
+    glFinish();
+    return elapsedMs(start) / repetitions;
+}
+
+// --------------------------------------------------------------------------
+// Scene 3: the sentence as tessellated outlines
+
+struct OutlinePrograms {
+    GLuint lines[4];    // GL lines, drawn multisampled
+    GLuint strokes[4];  // analytic coverage
+};
+
+bool createOutlinePrograms(OutlinePrograms *programs) {
+    string vertexSource = loadSource("shaders/vertex.glsl");
+    string fragmentSource = loadSource("shaders/fragment.glsl");
+    string tcsSource = loadSource("shaders/tessControl.glsl");
+    string tesSource = loadSource("shaders/tessEval.glsl");
+    string strokeGeometrySource = loadSource("shaders/strokeGeometry.glsl");
+    string strokeFragmentSource = loadSource("shaders/strokeFragment.glsl");
+
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    GLuint strokeGeometry = compileShader(GL_GEOMETRY_SHADER, strokeGeometrySource);
+    GLuint strokeFragment = compileShader(GL_FRAGMENT_SHADER, strokeFragmentSource);
+    bool linked = true;
+    for (int d = 1; d <= 3; d++) {
+        GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource, d);
+        GLuint tcs = d > 1 ? compileShader(GL_TESS_CONTROL_SHADER, tcsSource, d) : 0;
+        GLuint tes = d > 1 ? compileShader(GL_TESS_EVALUATION_SHADER, tesSource, d) : 0;
+
+        GLuint lines[] = { vertex, tcs, tes, fragment };
+        GLuint strokes[] = { vertex, tcs, tes, strokeGeometry, strokeFragment };
+        programs->lines[d] = linkProgram(vector<GLuint>(lines, lines + 4));
+        programs->strokes[d] = linkProgram(vector<GLuint>(strokes, strokes + 5));
+        linked = linked && programs->lines[d] && programs->strokes[d];
+
+        glDeleteShader(vertex);
+        glDeleteShader(tcs);
+        glDeleteShader(tes);
+    }
+    glDeleteShader(fragment);
+    glDeleteShader(strokeGeometry);
+    glDeleteShader(strokeFragment);
+    return linked;
+}
+
+// the shared glyph patches, one after another by degree, and the pens of a
+// line as instances, laid out as the program does
+struct OutlineGeometry {
+    GLuint vertexArray, buffers[3];
+    GLint batchFirst[4];
+};
+
+OutlineGeometry createOutlineGeometry(const PatchLists &patches, const TextLine &line) {
+    vector<vec2> points;
+    vector<vec3> colours;
+    OutlineGeometry geometry;
+    for (int d = 0; d < 4; d++) {
+        geometry.batchFirst[d] = points.size();
+        points.insert(points.end(), patches.points[d].begin(), patches.points[d].end());
+        colours.insert(colours.end(), patches.colours[d].begin(), patches.colours[d].end());
+    }
+
+    glGenVertexArrays(1, &geometry.vertexArray);
+    glBindVertexArray(geometry.vertexArray);
+    glGenBuffers(3, geometry.buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(vec2), points.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, colours.size() * sizeof(vec3), colours.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), 0);
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.buffers[2]);
+    glBufferData(GL_ARRAY_BUFFER, line.pens.size() * sizeof(vec2), line.pens.data(),
+                 GL_STATIC_DRAW);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    return geometry;
+}
+
+void destroyOutlineGeometry(OutlineGeometry *geometry) {
+    glDeleteVertexArrays(1, &geometry->vertexArray);
+    glDeleteBuffers(3, geometry->buffers);
+}
+
+// draws a line as RenderScene does, counting the primitives the curves make
+void drawOutlines(const OutlineGeometry &geometry, const TextLine &line, const GLuint *programs,
+                  bool blend, vec2 offset, vec2 viewport, GLuint query) {
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (blend) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    glBindVertexArray(geometry.vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.buffers[2]);
+    for (int d = 1; d <= 3; d++) {
+        if (query && d == 2)
+            glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+
+        glUseProgram(programs[d]);
+        glUniform2f(glGetUniformLocation(programs[d], "offset"), offset.x, offset.y);
+        glUniform1f(glGetUniformLocation(programs[d], "scale"), line.size);
+        glUniform2f(glGetUniformLocation(programs[d], "viewport"), viewport.x, viewport.y);
+        glUniform1f(glGetUniformLocation(programs[d], "strokeWidth"), 1.0f);
+        glUniform1f(glGetUniformLocation(programs[d], "tolerance"), TOLERANCE);
+        GLenum mode = d > 1 ? GL_PATCHES : GL_LINES;
+        if (d > 1)
+            glPatchParameteri(GL_PATCH_VERTICES, d + 1);
+
+        for (size_t i = 0; i < line.runs.size(); i++) {
+            const GlyphRun &run = line.runs[i];
+            if (run.count[d] == 0)
+                continue;
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vec2),
+                                  (void *)(run.firstInstance * sizeof(vec2)));
+            glDrawArraysInstanced(mode, geometry.batchFirst[d] + run.first[d], run.count[d],
+                                  run.instanceCount);
+        }
+    }
+    if (query)
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDisable(GL_BLEND);
+}
+
+void benchOutlineScene(const BenchConfig &config, FontManager &fonts,
+                       const OutlinePrograms &programs, const Framebuffers &fb) {
+    vec2 viewport(config.width, config.height);
+    GLuint query;
+    glGenQueries(1, &query);
+
+    for (int f = 0; f < 3; f++) {
+        int face = fonts.LoadFont(SCROLL_FONTS[f]);
+        if (face < 0)
+            continue;
+
+        TextLayout layout(fonts);
+        const TextLine &line = layout.Layout(SENTENCE, face, SENTENCE_SIZE);
+        OutlineGeometry geometry = createOutlineGeometry(layout.Patches(), line);
+
+        size_t points = 0;
+        for (int d = 1; d <= 3; d++)
+            points += line.SegmentCount(d) * (d + 1);
+        size_t patches = line.SegmentCount(2) + line.SegmentCount(3);
+        record("scene3", SCROLL_FONTS[f], "control points", points, "per frame");
+        record("scene3", SCROLL_FONTS[f], "lines", line.SegmentCount(1), "per frame");
+        record("scene3", SCROLL_FONTS[f], "patches", patches, "per frame");
+
+        // the stroke programs draw each segment of a curve as two triangles
+        glBindFramebuffer(GL_FRAMEBUFFER, fb.single);
+        drawOutlines(geometry, line, programs.strokes, true, vec2(-1.0f, -0.2f), viewport, query);
+        GLuint primitives = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &primitives);
+        record("scene3", SCROLL_FONTS[f], "tessellated vertices", primitives / 2 + patches,
+               "per frame");
+
+        for (size_t p = 0; p < sizeof(SENTENCE_POSITIONS) / sizeof(float); p++) {
+            vec2 offset(-1.0f - SENTENCE_POSITIONS[p], -0.2f);
+            string position = "@" + to_string(int(SENTENCE_POSITIONS[p]));
+
+            double analytic = timeFrames(config.repetitions, [&]() {
+                glBindFramebuffer(GL_FRAMEBUFFER, fb.single);
+                drawOutlines(geometry, line, programs.strokes, true, offset, viewport, 0);
+            });
+            double multisampled = timeFrames(config.repetitions, [&]() {
+                glBindFramebuffer(GL_FRAMEBUFFER, fb.multi);
+                drawOutlines(geometry, line, programs.lines, false, offset, viewport, 0);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, fb.multi);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb.single);
+                glBlitFramebuffer(0, 0, config.width, config.height, 0, 0, config.width,
+                                  config.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            });
+            record("scene3", SCROLL_FONTS[f], "frame analytic " + position, analytic, "ms");
+            record("scene3", SCROLL_FONTS[f], "frame msaa4 " + position, multisampled, "ms");
+        }
+
+        destroyOutlineGeometry(&geometry);
+    }
+    glDeleteQueries(1, &query);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// --------------------------------------------------------------------------
+// Scenes 4 and 5: distance field text, as a sentence and as a document
+
+struct QuadGeometry {
+    GLuint vertexArray, corners, instances;
+    size_t capacity;
+};
+
+QuadGeometry createQuadGeometry(size_t capacity) {
+    const vec2 corners[4] = { vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1) };
+
+    QuadGeometry geometry;
+    geometry.capacity = capacity;
+    glGenVertexArrays(1, &geometry.vertexArray);
+    glBindVertexArray(geometry.vertexArray);
+    glGenBuffers(1, &geometry.corners);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.corners);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &geometry.instances);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.instances);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GlyphQuad), 0, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+                          (void *)offsetof(GlyphQuad, plane));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+                          (void *)offsetof(GlyphQuad, texels));
+    glVertexAttribDivisor(1, 1);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    return geometry;
+}
+
+void destroyQuadGeometry(QuadGeometry *geometry) {
+    glDeleteVertexArrays(1, &geometry->vertexArray);
+    glDeleteBuffers(1, &geometry->corners);
+    glDeleteBuffers(1, &geometry->instances);
+}
+
+GLuint createAtlasTexture(const GlyphAtlas &atlas) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas.Width(), atlas.Height(), 0, GL_RED,
+                 GL_UNSIGNED_BYTE, atlas.Pixels().data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+// starts a frame of distance field text as RenderAtlasText does
+void beginAtlasText(GLuint program, GLuint texture, const QuadGeometry &geometry, vec2 offset) {
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(program);
+    glUniform2f(glGetUniformLocation(program, "offset"), offset.x, offset.y);
+    glUniform3f(glGetUniformLocation(program, "colour"), 1.0f, 1.0f, 1.0f);
+    glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindVertexArray(geometry.vertexArray);
+}
+
+void endAtlasText() {
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glDisable(GL_BLEND);
+}
+
+void benchAtlasScenes(const BenchConfig &config, FontManager &fonts, const GlyphAtlas *atlases,
+                      const string &document, const Framebuffers &fb) {
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, loadSource("shaders/sdfVertex.glsl"));
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, loadSource("shaders/sdfFragment.glsl"));
+    GLuint shaders[] = { vertex, fragment };
+    GLuint program = linkProgram(vector<GLuint>(shaders, shaders + 2));
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    if (!program)
+        return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fb.single);
+    for (int f = 0; f < 3; f++) {
+        int face = fonts.LoadFont(SCROLL_FONTS[f]);
+        if (face < 0 || atlases[f].GlyphCount() == 0)
+            continue;
+        GLuint texture = createAtlasTexture(atlases[f]);
+
+        // scene 4: the sentence, one quad per character
+        vector<GlyphQuad> quads;
+        atlases[f].Layout(fonts, face, SENTENCE, SENTENCE_SIZE, &quads);
+        QuadGeometry sentence = createQuadGeometry(quads.size());
+        glBindBuffer(GL_ARRAY_BUFFER, sentence.instances);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, quads.size() * sizeof(GlyphQuad), quads.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        record("scene4", SCROLL_FONTS[f], "quads", quads.size(), "per frame");
+
+        for (size_t p = 0; p < sizeof(SENTENCE_POSITIONS) / sizeof(float); p++) {
+            vec2 offset(-1.0f - SENTENCE_POSITIONS[p], -0.2f);
+            double ms = timeFrames(config.repetitions, [&]() {
+                beginAtlasText(program, texture, sentence, offset);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, quads.size());
+                endAtlasText();
+            });
+            record("scene4", SCROLL_FONTS[f], "frame @" + to_string(int(SENTENCE_POSITIONS[p])),
+                   ms, "ms");
+        }
+        destroyQuadGeometry(&sentence);
+
+        // scene 5: the document, brought into view at each position and then
+        // scrolled a line a frame, so every frame updates the view. It is
+        // wrapped to the end first, as it wraps to a different height in
+        // each font.
+        TextView view(fonts, atlases[f], face, 0.08f, 1.9f, 0.1f, 32, 128);
+        view.SetText(document);
+        view.Update(1e9f, 2.0f, 4);
+        float height = view.LinesWrapped() * view.LineHeight();
+        QuadGeometry slots = createQuadGeometry(view.SlotCount() * view.SlotCapacity());
+        for (size_t p = 0; p < sizeof(DOCUMENT_POSITIONS) / sizeof(float); p++) {
+            float scroll = DOCUMENT_POSITIONS[p] * height;
+            view.Update(scroll, 2.0f, 4);
+            size_t drawn = 0;
+            double ms = timeFrames(config.repetitions, [&]() {
+                scroll += view.LineHeight();
+                view.Update(scroll, 2.0f, 4);
+
+                glBindBuffer(GL_ARRAY_BUFFER, slots.instances);
+                const vector<int> &dirty = view.DirtySlots();
+                for (size_t i = 0; i < dirty.size(); i++) {
+                    const vector<GlyphQuad> &slotQuads = view.SlotQuads(dirty[i]);
+                    glBufferSubData(GL_ARRAY_BUFFER,
+                                    size_t(dirty[i]) * view.SlotCapacity() * sizeof(GlyphQuad),
+                                    slotQuads.size() * sizeof(GlyphQuad), slotQuads.data());
+                }
+
+                beginAtlasText(program, texture, slots, vec2(-0.95f, 1.0f + scroll));
+                const vector<ViewSlot> &visible = view.VisibleSlots();
+                drawn = 0;
+                for (size_t i = 0; i < visible.size(); i++) {
+                    size_t first = size_t(visible[i].slot) * view.SlotCapacity();
+                    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+                                          (void *)(first * sizeof(GlyphQuad) +
+                                                   offsetof(GlyphQuad, plane)));
+                    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+                                          (void *)(first * sizeof(GlyphQuad) +
+                                                   offsetof(GlyphQuad, texels)));
+                    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, visible[i].count);
+                    drawn += visible[i].count;
+                }
+                endAtlasText();
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            });
+            string position = "@" + to_string(int(DOCUMENT_POSITIONS[p] * 100)) + "%";
+            record("scene5", SCROLL_FONTS[f], "quads " + position, drawn, "per frame");
+            record("scene5", SCROLL_FONTS[f], "frame " + position, ms, "ms");
+        }
+        destroyQuadGeometry(&slots);
+        glDeleteTextures(1, &texture);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteProgram(program);
+}
+
+// --------------------------------------------------------------------------
+// Reporting
+
+string quoted(const string &text) {
+    string out = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '"' || text[i] == '\\')
+            out += '\\';
+        out += text[i];
+    }
+    return out + "\"";
+}
+
+void printResults(const BenchConfig &config) {
+    if (config.json) {
+        printf("{\n  \"repetitions\": %d,\n  \"results\": [\n", config.repetitions);
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            printf("    { \"benchmark\": %s, \"font\": %s, \"case\": %s, \"value\": %.6g, "
+                   "\"unit\": %s }%s\n", quoted(r.benchmark).c_str(), quoted(r.font).c_str(),
+                   quoted(r.variant).c_str(), r.value, quoted(r.unit).c_str(),
+                   i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else {
+        printf("benchmark,font,case,value,unit\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            printf("%s,%s,%s,%.6g,%s\n", r.benchmark.c_str(), r.font.c_str(),
+                   r.variant.c_str(), r.value, r.unit.c_str());
+        }
+    }
+}
+
+// ==========================================================================
+// PROGRAM ENTRY POINT
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0)
+            config.json = true;
+        else
+            config.repetitions = std::max(1, atoi(argv[i]));
+    }
+
+    FontManager fonts;
+    string document = generateDocument();
+
+    // the atlases are built, or read from the program's cache, up front
+    GlyphAtlas atlases[3];
+    vector<int> codes;
+    for (int c = 32; c < 127; c++)
+        codes.push_back(c);
+    for (int f = 0; f < 3; f++) {
+        int face = fonts.LoadFont(SCROLL_FONTS[f]);
+        if (face >= 0)
+            atlases[f].LoadOrBuild(fonts, face, codes, ATLAS_PIXELS_PER_EM, ATLAS_RANGE);
+    }
+
+    benchExtraction(config);
+    benchLayout(config, fonts, atlases, document);
+
+    if (createContext()) {
+        glViewport(0, 0, config.width, config.height);
+        Framebuffers fb = createFramebuffers(config.width, config.height);
+
+        OutlinePrograms programs;
+        if (createOutlinePrograms(&programs))
+            benchOutlineScene(config, fonts, programs, fb);
+        benchAtlasScenes(config, fonts, atlases, document, fb);
+    }
+
+    printResults(config);
+    return 0;
+}
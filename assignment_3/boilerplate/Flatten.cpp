@@ -0,0 +1,214 @@
+// ==========================================================================
+// CPU Curve Flattening for Assignment 3
+// ==========================================================================
+
+#include "Flatten.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+// SIMD lanes: one curve per lane, with the same few operations on each ISA
+
+#if defined(__AVX__)
+
+const int LANES = 8;
+typedef __m256 Lanes;
+
+inline Lanes lanesSet(float v)              { return _mm256_set1_ps(v); }
+inline Lanes lanesLoad(const float *p)      { return _mm256_loadu_ps(p); }
+inline void lanesStore(float *p, Lanes v)   { _mm256_storeu_ps(p, v); }
+inline Lanes lanesAdd(Lanes a, Lanes b)     { return _mm256_add_ps(a, b); }
+inline Lanes lanesSub(Lanes a, Lanes b)     { return _mm256_sub_ps(a, b); }
+inline Lanes lanesMul(Lanes a, Lanes b)     { return _mm256_mul_ps(a, b); }
+inline Lanes lanesMin(Lanes a, Lanes b)     { return _mm256_min_ps(a, b); }
+
+#elif defined(__SSE__) || defined(_M_X64)
+
+const int LANES = 4;
+typedef __m128 Lanes;
+
+inline Lanes lanesSet(float v)              { return _mm_set1_ps(v); }
+inline Lanes lanesLoad(const float *p)      { return _mm_loadu_ps(p); }
+inline void lanesStore(float *p, Lanes v)   { _mm_storeu_ps(p, v); }
+inline Lanes lanesAdd(Lanes a, Lanes b)     { return _mm_add_ps(a, b); }
+inline Lanes lanesSub(Lanes a, Lanes b)     { return _mm_sub_ps(a, b); }
+inline Lanes lanesMul(Lanes a, Lanes b)     { return _mm_mul_ps(a, b); }
+inline Lanes lanesMin(Lanes a, Lanes b)     { return _mm_min_ps(a, b); }
+
+#else
+
+const int LANES = 4;
+struct Lanes { float v[LANES]; };
+
+inline Lanes lanesSet(float x)              { Lanes r; for (int i = 0; i < LANES; i++) r.v[i] = x; return r; }
+inline Lanes lanesLoad(const float *p)      { Lanes r; for (int i = 0; i < LANES; i++) r.v[i] = p[i]; return r; }
+inline void lanesStore(float *p, Lanes a)   { for (int i = 0; i < LANES; i++) p[i] = a.v[i]; }
+inline Lanes lanesAdd(Lanes a, Lanes b)     { for (int i = 0; i < LANES; i++) a.v[i] += b.v[i]; return a; }
+inline Lanes lanesSub(Lanes a, Lanes b)     { for (int i = 0; i < LANES; i++) a.v[i] -= b.v[i]; return a; }
+inline Lanes lanesMul(Lanes a, Lanes b)     { for (int i = 0; i < LANES; i++) a.v[i] *= b.v[i]; return a; }
+inline Lanes lanesMin(Lanes a, Lanes b)     { for (int i = 0; i < LANES; i++) a.v[i] = std::min(a.v[i], b.v[i]); return a; }
+
+#endif
+
+inline Lanes lanesLerp(Lanes a, Lanes b, Lanes t) { return lanesAdd(a, lanesMul(lanesSub(b, a), t)); }
+
+// --------------------------------------------------------------------------
+
+// Evenly sampling a Bezier curve of degree n at N steps strays from it by
+// at most n(n-1)/8 * M / N^2, where M is the longest second difference of
+// the control points, so N follows from the tolerance.
+int FlattenSteps(const MySegment &segment, float tolerance)
+{
+    int n = segment.degree;
+    if (n < 2)
+        return 1;
+
+    float m = 0.0f;
+    for (int i = 0; i + 2 <= n; i++) {
+        float dx = segment.x[i] - 2.0f * segment.x[i + 1] + segment.x[i + 2];
+        float dy = segment.y[i] - 2.0f * segment.y[i + 1] + segment.y[i + 2];
+        m = std::max(m, std::sqrt(dx * dx + dy * dy));
+    }
+
+    float steps = std::ceil(std::sqrt(n * (n - 1) * m / (8.0f * tolerance)));
+    return int(std::min(std::max(steps, 1.0f), float(MAX_FLATTEN_STEPS)));
+}
+
+size_t FlattenedPointCount(const MyContour &contour, float tolerance)
+{
+    if (contour.empty())
+        return 0;
+
+    size_t count = 1;
+    for (size_t i = 0; i < contour.size(); i++) {
+        if (contour[i].degree > 0)
+            count += FlattenSteps(contour[i], tolerance);
+    }
+    return count;
+}
+
+// Evaluates up to LANES curves of one degree at once by de Casteljau's
+// algorithm. Curve k has steps[k] samples after its start point, written
+// from out[k]; lanes whose curve has finished keep evaluating its end point
+// and their results are dropped.
+void flattenBatch(const MySegment *const *curves, int count, int degree,
+                  const int *steps, vec2 *const *out)
+{
+    float x[4][LANES];
+    float y[4][LANES];
+    float inverse[LANES];
+    int longest = 0;
+
+    for (int k = 0; k < LANES; k++) {
+        const MySegment &s = *curves[std::min(k, count - 1)];
+        for (int i = 0; i <= degree; i++) {
+            x[i][k] = s.x[i];
+            y[i][k] = s.y[i];
+        }
+        int n = k < count ? steps[k] : 1;
+        inverse[k] = 1.0f / n;
+        longest = std::max(longest, n);
+    }
+
+    Lanes px[4], py[4];
+    for (int i = 0; i <= degree; i++) {
+        px[i] = lanesLoad(x[i]);
+        py[i] = lanesLoad(y[i]);
+    }
+    Lanes dt = lanesLoad(inverse);
+    Lanes one = lanesSet(1.0f);
+
+    float rx[LANES];
+    float ry[LANES];
+    for (int j = 1; j <= longest; j++) {
+        Lanes t = lanesMin(lanesMul(lanesSet(float(j)), dt), one);
+
+        Lanes ax = lanesLerp(px[0], px[1], t), ay = lanesLerp(py[0], py[1], t);
+        Lanes bx = lanesLerp(px[1], px[2], t), by = lanesLerp(py[1], py[2], t);
+        if (degree == 3) {
+            Lanes cx = lanesLerp(px[2], px[3], t), cy = lanesLerp(py[2], py[3], t);
+            ax = lanesLerp(ax, bx, t);  ay = lanesLerp(ay, by, t);
+            bx = lanesLerp(bx, cx, t);  by = lanesLerp(by, cy, t);
+        }
+        lanesStore(rx, lanesLerp(ax, bx, t));
+        lanesStore(ry, lanesLerp(ay, by, t));
+
+        for (int k = 0; k < count; k++) {
+            if (j <= steps[k])
+                out[k][j - 1] = vec2(rx[k], ry[k]);
+        }
+    }
+}
+
+bool FlattenContour(const MyContour &contour, float tolerance, FlattenArena *arena)
+{
+    if (contour.empty())
+        return true;
+
+    size_t total = FlattenedPointCount(contour, tolerance);
+    if (arena->pointCount + total > arena->pointCapacity || arena->lineCount >= arena->lineCapacity)
+        return false;
+
+    vec2 *start = arena->points + arena->pointCount;
+    start[0] = vec2(contour[0].x[0], contour[0].y[0]);
+
+    // where each curve's samples go, gathered into batches by degree
+    const MySegment *batch[2][LANES];
+    int batchSteps[2][LANES];
+    vec2 *batchOut[2][LANES];
+    int batchSize[2] = { 0, 0 };
+
+    vec2 *next = start + 1;
+    for (size_t i = 0; i < contour.size(); i++) {
+        const MySegment &segment = contour[i];
+        if (segment.degree == 0)
+            continue;
+
+        if (segment.degree == 1) {
+            *next++ = vec2(segment.x[1], segment.y[1]);
+            continue;
+        }
+
+        int d = segment.degree - 2;
+        int k = batchSize[d]++;
+        batch[d][k] = &segment;
+        batchSteps[d][k] = FlattenSteps(segment, tolerance);
+        batchOut[d][k] = next;
+        next += batchSteps[d][k];
+
+        if (batchSize[d] == LANES) {
+            flattenBatch(batch[d], LANES, segment.degree, batchSteps[d], batchOut[d]);
+            batchSize[d] = 0;
+        }
+    }
+
+    for (int d = 0; d < 2; d++) {
+        if (batchSize[d] > 0)
+            flattenBatch(batch[d], batchSize[d], d + 2, batchSteps[d], batchOut[d]);
+    }
+
+    Polyline &line = arena->lines[arena->lineCount++];
+    line.first = arena->pointCount;
+    line.count = total;
+    arena->pointCount += total;
+    return true;
+}
+
+bool FlattenGlyph(const MyGlyph &glyph, float tolerance, FlattenArena *arena)
+{
+    for (size_t i = 0; i < glyph.contours.size(); i++) {
+        if (!FlattenContour(glyph.contours[i], tolerance, arena))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+// ==========================================================================
+// CPU Curve Flattening for Assignment 3
+//
+// Turns the contours of a glyph into closed polylines, for uses that have
+// no GPU tessellator (export, hit-testing, headless builds). Each curve gets
+// the fewest evenly spaced samples that keep it within a tolerance of the
+// true curve, using the same bound as shaders/tessControl.glsl. Curves of
+// the same degree are evaluated side by side in SIMD lanes (SSE, or AVX
+// when compiled with -mavx), with a scalar fallback elsewhere.
+//
+// Output goes into memory owned by the caller, so flattening a whole font
+// does not allocate.
+// ==========================================================================
+#ifndef FLATTEN_H
+#define FLATTEN_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+
+// One flattened contour: count points starting at first in the arena. The
+// last point repeats the first, closing the outline.
+struct Polyline
+{
+    size_t first;
+    size_t count;
+};
+
+// Caller-provided storage for flattened output. Points of all polylines
+// are packed back to back; reset the counts to reuse the memory.
+struct FlattenArena
+{
+    glm::vec2 *points;
+    size_t pointCapacity;
+    size_t pointCount;
+
+    Polyline *lines;
+    size_t lineCapacity;
+    size_t lineCount;
+
+    FlattenArena(glm::vec2 *p, size_t pCapacity, Polyline *l, size_t lCapacity)
+        : points(p), pointCapacity(pCapacity), pointCount(0),
+          lines(l), lineCapacity(lCapacity), lineCount(0)
+    {}
+
+    void Reset() { pointCount = 0; lineCount = 0; }
+};
+
+const int MAX_FLATTEN_STEPS = 64;
+
+// number of line segments used for a curve so that it strays at most
+// tolerance from the true curve (1 for lines, at most MAX_FLATTEN_STEPS)
+int FlattenSteps(const MySegment &segment, float tolerance);
+
+// number of points FlattenContour will write for contour
+size_t FlattenedPointCount(const MyContour &contour, float tolerance);
+
+// Appends contour to arena as one closed polyline, with tolerance in the
+// units of the outline (EM units for glyphs). Returns false and leaves the
+// arena unchanged if the output does not fit.
+bool FlattenContour(const MyContour &contour, float tolerance, FlattenArena *arena);
+
+// appends every contour of glyph, stopping at the first that does not fit
+bool FlattenGlyph(const MyGlyph &glyph, float tolerance, FlattenArena *arena);
+
+// --------------------------------------------------------------------------
+#endif // FLATTEN_H
@@ -0,0 +1,120 @@
+// ==========================================================================
+// Font and Glyph Caching for Assignment 3
+// ==========================================================================
+
+#include "FontManager.h"
+#include <iostream>
+#include <sys/stat.h>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+FontManager::FontManager()
+    : m_hits(0), m_misses(0)
+{
+}
+
+FontManager::~FontManager()
+{
+    for (size_t i = 0; i < m_fonts.size(); ++i) {
+        delete m_fonts[i].bundle;
+        delete m_fonts[i].extractor;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// true if bundleFile exists and fontFile, if it exists, is not newer
+static bool BundleIsCurrent(const string &fontFile, const string &bundleFile)
+{
+    struct stat bundleInfo, fontInfo;
+    if (stat(bundleFile.c_str(), &bundleInfo) != 0)
+        return false;
+    if (stat(fontFile.c_str(), &fontInfo) == 0 && fontInfo.st_mtime > bundleInfo.st_mtime) {
+        cout << "Glyph bundle " << bundleFile << " is older than " << fontFile
+             << ", reading the font instead" << endl;
+        return false;
+    }
+    return true;
+}
+
+int FontManager::LoadFont(const string &filename)
+{
+    for (size_t i = 0; i < m_fonts.size(); ++i) {
+        if (m_fonts[i].filename == filename)
+            return m_fonts[i].Loaded() ? int(i) : -1;
+    }
+
+    Font font;
+    font.filename = filename;
+    font.bundle = 0;
+    font.extractor = 0;
+
+    string bundleFile = BundlePath(filename);
+    if (BundleIsCurrent(filename, bundleFile)) {
+        font.bundle = new GlyphBundle();
+        if (!font.bundle->Open(bundleFile)) {
+            delete font.bundle;
+            font.bundle = 0;
+        }
+    }
+
+    if (!font.bundle) {
+        font.extractor = new GlyphExtractor();
+        if (!font.extractor->LoadFontFile(filename)) {
+            delete font.extractor;
+            font.extractor = 0;
+        }
+    }
+    m_fonts.push_back(font);
+
+    return font.Loaded() ? int(m_fonts.size() - 1) : -1;
+}
+
+const GlyphOutline &FontManager::GetOutline(int font, int character)
+{
+    unsigned long long key = ((unsigned long long)font << 32) | (unsigned int)character;
+
+    unordered_map<unsigned long long, GlyphOutline>::iterator it = m_glyphs.find(key);
+    if (it != m_glyphs.end()) {
+        ++m_hits;
+        return it->second;
+    }
+
+    ++m_misses;
+    GlyphOutline &glyph = m_glyphs[key];
+    if (m_fonts[font].bundle)
+        m_fonts[font].bundle->ReadOutline(character, &glyph);
+    else
+        m_fonts[font].extractor->ExtractOutline(character, &glyph);
+    return glyph;
+}
+
+float FontManager::GetKerning(int font, int left, int right) const
+{
+    if (m_fonts[font].bundle)
+        return m_fonts[font].bundle->GetKerning(left, right);
+    return m_fonts[font].extractor->GetKerning(left, right);
+}
+
+// --------------------------------------------------------------------------
+
+void FontManager::PrintStats() const
+{
+    unsigned long long lookups = m_hits + m_misses;
+    double rate = lookups ? 100.0 * m_hits / lookups : 0.0;
+
+    int loaded = 0;
+    int bundled = 0;
+    for (size_t i = 0; i < m_fonts.size(); ++i) {
+        if (m_fonts[i].Loaded())
+            ++loaded;
+        if (m_fonts[i].bundle)
+            ++bundled;
+    }
+
+    cout << "Glyph cache: " << m_hits << " hits, " << m_misses << " misses ("
+         << rate << "% hit rate), " << m_glyphs.size() << " glyphs from "
+         << loaded << " fonts (" << bundled << " from bundles)" << endl;
+}
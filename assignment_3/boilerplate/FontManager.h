@@ -0,0 +1,76 @@
+// ==========================================================================
+// Font and Glyph Caching for Assignment 3
+//
+// Keeps every font file that has been asked for open for the lifetime of the
+// program, and remembers each glyph outline the first time it is extracted,
+// so building a line of text only goes to FreeType for characters it has
+// not seen before in that font. Outlines are kept as packed GlyphOutlines
+// rather than MyGlyphs, which take 30-45% less memory.
+//
+// If a glyph bundle built by the bundle tool sits next to a font file, and
+// is no older than it, glyphs and kerning are read from the mapped bundle
+// instead and the font file is never opened.
+// ==========================================================================
+#ifndef FONTMANAGER_H
+#define FONTMANAGER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GlyphBundle.h"
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+
+class FontManager
+{
+    // one entry per font file requested, including ones that failed to
+    // load, so a missing file is only reported once; a font is read through
+    // its bundle if it has one, and otherwise its extractor
+    struct Font {
+        std::string filename;
+        GlyphBundle *bundle;
+        GlyphExtractor *extractor;
+
+        bool Loaded() const { return bundle || extractor; }
+    };
+    std::vector<Font> m_fonts;
+
+    // outlines keyed by font index in the upper 32 bits and character code
+    // in the lower; elements of an unordered_map never move, so references
+    // handed out stay valid
+    std::unordered_map<unsigned long long, GlyphOutline> m_glyphs;
+
+    unsigned long long m_hits;
+    unsigned long long m_misses;
+
+    FontManager(const FontManager &);
+    FontManager &operator=(const FontManager &);
+
+public:
+    FontManager();
+    ~FontManager();
+
+    // returns an index for the font in filename, loading the file the first
+    // time it is asked for, or -1 if it could not be loaded
+    int LoadFont(const std::string &filename);
+
+    // the file name a loaded font was asked for by
+    const std::string &FontFile(int font) const { return m_fonts[font].filename; }
+
+    // returns the outline of character in a loaded font
+    const GlyphOutline &GetOutline(int font, int character);
+
+    // kerning to add between left and right in a loaded font, in EM units
+    float GetKerning(int font, int left, int right) const;
+
+    // number of glyph lookups answered from the cache, and that were not
+    unsigned long long Hits() const   { return m_hits; }
+    unsigned long long Misses() const { return m_misses; }
+
+    void PrintStats() const;
+};
+
+// --------------------------------------------------------------------------
+#endif // FONTMANAGER_H
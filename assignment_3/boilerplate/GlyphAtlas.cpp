@@ -0,0 +1,474 @@
+// ==========================================================================
+// Signed Distance Field Glyph Atlas for Assignment 3
+// ==========================================================================
+
+#include "GlyphAtlas.h"
+#include "Flatten.h"
+#include "TextLayout.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+// Distances to single segments
+
+// real roots of a t^3 + b t^2 + c t + d, returning how many there are
+static int solveCubic(float a, float b, float c, float d, float roots[3])
+{
+    if (fabs(a) < 1e-7f * (fabs(b) + fabs(c) + fabs(d))) {
+        if (fabs(b) < 1e-12f) {
+            if (fabs(c) < 1e-12f)
+                return 0;
+            roots[0] = -d / c;
+            return 1;
+        }
+        float discriminant = c * c - 4.0f * b * d;
+        if (discriminant < 0.0f)
+            return 0;
+        float root = sqrt(discriminant);
+        roots[0] = (-c + root) / (2.0f * b);
+        roots[1] = (-c - root) / (2.0f * b);
+        return 2;
+    }
+
+    // depressed cubic x^3 + p x + q with t = x - b / 3a
+    double A = b / a, B = c / a, C = d / a;
+    double p = B - A * A / 3.0;
+    double q = 2.0 * A * A * A / 27.0 - A * B / 3.0 + C;
+    double shift = -A / 3.0;
+    double discriminant = q * q / 4.0 + p * p * p / 27.0;
+
+    if (discriminant > 0.0) {
+        double root = sqrt(discriminant);
+        roots[0] = float(cbrt(-q / 2.0 + root) + cbrt(-q / 2.0 - root) + shift);
+        return 1;
+    }
+
+    double r = sqrt(-p / 3.0);
+    double angle = acos(std::max(-1.0, std::min(1.0, -q / (2.0 * r * r * r)))) / 3.0;
+    for (int k = 0; k < 3; k++)
+        roots[k] = float(2.0 * r * cos(angle - 2.0 * M_PI * k / 3.0) + shift);
+    return 3;
+}
+
+static float lineDistance(const vec2 *c, vec2 p)
+{
+    vec2 d = c[1] - c[0];
+    float t = clamp(dot(p - c[0], d) / std::max(dot(d, d), 1e-20f), 0.0f, 1.0f);
+    return length(c[0] + t * d - p);
+}
+
+// The closest point makes B(t) - p perpendicular to B'(t), a cubic in t
+static float quadraticDistance(const vec2 *c, vec2 p)
+{
+    vec2 m = c[0] - p;
+    vec2 a = c[1] - c[0];
+    vec2 b = c[2] - 2.0f * c[1] + c[0];
+
+    float best = std::min(length(m), length(c[2] - p));
+    float roots[3];
+    int count = solveCubic(dot(b, b), 3.0f * dot(a, b), 2.0f * dot(a, a) + dot(m, b), dot(m, a), roots);
+    for (int i = 0; i < count; i++) {
+        float t = roots[i];
+        if (t > 0.0f && t < 1.0f)
+            best = std::min(best, length(m + 2.0f * t * a + t * t * b));
+    }
+    return best;
+}
+
+// The same condition is a quintic for cubics, so it is solved by Newton's
+// method from evenly spaced starting points
+static float cubicDistance(const vec2 *c, vec2 p)
+{
+    const int STARTS = 4;
+    const int STEPS = 4;
+
+    vec2 a = c[1] - c[0];
+    vec2 b = c[2] - 2.0f * c[1] + c[0];
+    vec2 d = c[3] - 3.0f * c[2] + 3.0f * c[1] - c[0];
+
+    float best = std::min(length(c[0] - p), length(c[3] - p));
+    for (int i = 0; i <= STARTS; i++) {
+        float t = float(i) / STARTS;
+        for (int step = 0; step < STEPS; step++) {
+            vec2 q = c[0] + 3.0f * t * a + 3.0f * t * t * b + t * t * t * d - p;
+            vec2 d1 = 3.0f * a + 6.0f * t * b + 3.0f * t * t * d;
+            vec2 d2 = 6.0f * b + 6.0f * t * d;
+            float denominator = dot(d1, d1) + dot(q, d2);
+            if (fabs(denominator) < 1e-20f)
+                break;
+            t = clamp(t - dot(q, d1) / denominator, 0.0f, 1.0f);
+        }
+        vec2 q = c[0] + 3.0f * t * a + 3.0f * t * t * b + t * t * t * d - p;
+        best = std::min(best, length(q));
+    }
+    return best;
+}
+
+// --------------------------------------------------------------------------
+// Distance fields of whole glyphs
+
+// A glyph prepared for many distance queries: its segments with the boxes
+// around their control points, and a fine polyline of it for the sign.
+struct GlyphField
+{
+    struct Segment {
+        unsigned int degree;
+        const vec2 *points;
+        vec2 low, high;
+    };
+    vector<Segment> segments;
+    vector<vec2> edges;  // pairs of points
+
+    GlyphField(const GlyphOutline &outline, float tolerance)
+    {
+        for (size_t c = 0; c < outline.ContourCount(); c++) {
+            outline.VisitContour(c, [this, tolerance](const SegmentView &view) {
+                Segment s;
+                s.degree = view.degree;
+                s.points = view.points;
+                s.low = s.high = view[0];
+                for (unsigned int i = 1; i <= view.degree; i++) {
+                    s.low = min(s.low, view[i]);
+                    s.high = max(s.high, view[i]);
+                }
+                segments.push_back(s);
+
+                MySegment curve(view.degree);
+                for (unsigned int i = 0; i <= view.degree; i++) {
+                    curve.x[i] = view[i].x;
+                    curve.y[i] = view[i].y;
+                }
+                int steps = FlattenSteps(curve, tolerance);
+                vec2 previous = view[0];
+                for (int j = 1; j <= steps; j++) {
+                    vec2 next = evaluate(view, float(j) / steps);
+                    edges.push_back(previous);
+                    edges.push_back(next);
+                    previous = next;
+                }
+            });
+        }
+    }
+
+    static vec2 evaluate(const SegmentView &view, float t)
+    {
+        vec2 c[4];
+        for (unsigned int i = 0; i <= view.degree; i++)
+            c[i] = view[i];
+        for (unsigned int n = view.degree; n > 0; n--) {
+            for (unsigned int i = 0; i < n; i++)
+                c[i] = mix(c[i], c[i + 1], t);
+        }
+        return c[0];
+    }
+
+    // nonzero winding of the polyline around p, as TrueType fills
+    bool inside(vec2 p) const
+    {
+        int winding = 0;
+        for (size_t i = 0; i < edges.size(); i += 2) {
+            vec2 a = edges[i], b = edges[i + 1];
+            float side = (b.x - a.x) * (p.y - a.y) - (p.x - a.x) * (b.y - a.y);
+            if (a.y <= p.y) {
+                if (b.y > p.y && side > 0.0f)
+                    winding++;
+            } else if (b.y <= p.y && side < 0.0f) {
+                winding--;
+            }
+        }
+        return winding != 0;
+    }
+
+    float distance(vec2 p) const
+    {
+        float best = 1e30f;
+        for (size_t i = 0; i < segments.size(); i++) {
+            const Segment &s = segments[i];
+            vec2 outside = max(max(s.low - p, p - s.high), vec2(0.0f));
+            if (dot(outside, outside) >= best * best)
+                continue;
+
+            float d = s.degree == 1 ? lineDistance(s.points, p)
+                    : s.degree == 2 ? quadraticDistance(s.points, p)
+                    : cubicDistance(s.points, p);
+            best = std::min(best, d);
+        }
+        return inside(p) ? best : -best;
+    }
+};
+
+// --------------------------------------------------------------------------
+
+string AtlasPath(const string &fontFile, int pixelsPerEm)
+{
+    size_t dot = fontFile.find_last_of('.');
+    size_t slash = fontFile.find_last_of("/\\");
+    string base = fontFile;
+    if (dot != string::npos && (slash == string::npos || dot > slash))
+        base = fontFile.substr(0, dot);
+    return base + "-" + to_string(pixelsPerEm) + ".sdf";
+}
+
+GlyphAtlas::GlyphAtlas()
+    : m_pixelsPerEm(0), m_range(0), m_width(0), m_height(0)
+{
+}
+
+void GlyphAtlas::Build(FontManager &fonts, int font, const vector<int> &codes, int pixelsPerEm,
+                       float range, int width, int threads)
+{
+    m_pixelsPerEm = pixelsPerEm;
+    m_range = range;
+    m_width = width;
+    m_glyphs.clear();
+
+    vector<int> sorted(codes);
+    sort(sorted.begin(), sorted.end());
+    sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // outlines are fetched up front, since the font cache is not thread
+    // safe; each glyph's cell covers its control points plus the range
+    vector<const GlyphOutline *> outlines(sorted.size());
+    m_glyphs.resize(sorted.size());
+    int pad = int(ceil(range));
+    for (size_t i = 0; i < sorted.size(); i++) {
+        outlines[i] = &fonts.GetOutline(font, sorted[i]);
+        AtlasGlyph &glyph = m_glyphs[i];
+        memset(&glyph, 0, sizeof(glyph));
+        glyph.code = sorted[i];
+        glyph.advance = outlines[i]->Advance();
+
+        const vector<vec2> &points = outlines[i]->Points();
+        if (points.empty())
+            continue;
+
+        vec2 low = points[0], high = points[0];
+        for (size_t k = 1; k < points.size(); k++) {
+            low = min(low, points[k]);
+            high = max(high, points[k]);
+        }
+        int x0 = int(floor(low.x * pixelsPerEm)) - pad;
+        int y0 = int(floor(low.y * pixelsPerEm)) - pad;
+        int x1 = int(ceil(high.x * pixelsPerEm)) + pad;
+        int y1 = int(ceil(high.y * pixelsPerEm)) + pad;
+        glyph.width = x1 - x0;
+        glyph.height = y1 - y0;
+        glyph.left = float(x0) / pixelsPerEm;
+        glyph.bottom = float(y0) / pixelsPerEm;
+        glyph.right = float(x1) / pixelsPerEm;
+        glyph.top = float(y1) / pixelsPerEm;
+    }
+
+    // pack cells into shelves, tallest first, one texel apart
+    vector<size_t> order(m_glyphs.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return m_glyphs[a].height > m_glyphs[b].height;
+    });
+
+    int x = 0, y = 0, shelf = 0;
+    for (size_t k = 0; k < order.size(); k++) {
+        AtlasGlyph &glyph = m_glyphs[order[k]];
+        if (glyph.width == 0)
+            continue;
+        if (glyph.width > width) {
+            cout << "ERROR: Glyph " << glyph.code << " is wider than the atlas, leaving it out" << endl;
+            glyph.width = glyph.height = 0;
+            continue;
+        }
+        if (x + glyph.width > width) {
+            x = 0;
+            y += shelf + 1;
+            shelf = 0;
+        }
+        glyph.x = x;
+        glyph.y = y;
+        x += glyph.width + 1;
+        shelf = std::max(shelf, glyph.height);
+    }
+    m_height = y + shelf;
+    m_pixels.assign(size_t(m_width) * m_height, 0);
+
+    // each thread takes the next glyph until none are left, writing its
+    // distances straight into the glyph's own cell
+    atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i = next++; i < m_glyphs.size(); i = next++) {
+            const AtlasGlyph &glyph = m_glyphs[i];
+            if (glyph.width == 0)
+                continue;
+
+            GlyphField field(*outlines[i], 0.1f / pixelsPerEm);
+            for (int row = 0; row < glyph.height; row++) {
+                unsigned char *texel = &m_pixels[size_t(glyph.y + row) * m_width + glyph.x];
+                float py = glyph.bottom + (row + 0.5f) / pixelsPerEm;
+                for (int column = 0; column < glyph.width; column++) {
+                    vec2 p(glyph.left + (column + 0.5f) / pixelsPerEm, py);
+                    float d = field.distance(p) * pixelsPerEm;
+                    float value = clamp(0.5f + 0.5f * d / range, 0.0f, 1.0f);
+                    texel[column] = (unsigned char)(value * 255.0f + 0.5f);
+                }
+            }
+        }
+    };
+
+    if (threads <= 0)
+        threads = std::max(1u, thread::hardware_concurrency());
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.push_back(thread(work));
+    work();
+    for (size_t t = 0; t < pool.size(); t++)
+        pool[t].join();
+}
+
+// --------------------------------------------------------------------------
+// Cache files: a header, the glyph table, then the texels row by row
+
+struct AtlasHeader
+{
+    char magic[4];  // "A3SD"
+    unsigned int version;
+    int pixelsPerEm;
+    float range;
+    int width;
+    int height;
+    unsigned int glyphCount;
+};
+
+static const char ATLAS_MAGIC[4] = { 'A', '3', 'S', 'D' };
+static const unsigned int ATLAS_VERSION = 1;
+
+bool GlyphAtlas::Save(const string &filename) const
+{
+    AtlasHeader header;
+    memcpy(header.magic, ATLAS_MAGIC, sizeof(header.magic));
+    header.version = ATLAS_VERSION;
+    header.pixelsPerEm = m_pixelsPerEm;
+    header.range = m_range;
+    header.width = m_width;
+    header.height = m_height;
+    header.glyphCount = m_glyphs.size();
+
+    ofstream out(filename.c_str(), ios::binary);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)m_glyphs.data(), m_glyphs.size() * sizeof(AtlasGlyph));
+    out.write((const char *)m_pixels.data(), m_pixels.size());
+    if (!out) {
+        cout << "ERROR: Could not write glyph atlas " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+bool GlyphAtlas::Load(const string &filename)
+{
+    ifstream in(filename.c_str(), ios::binary);
+    if (!in)
+        return false;
+
+    AtlasHeader header;
+    if (!in.read((char *)&header, sizeof(header)) ||
+        memcmp(header.magic, ATLAS_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ATLAS_VERSION || header.width <= 0 || header.height < 0)
+        return false;
+
+    m_glyphs.resize(header.glyphCount);
+    m_pixels.resize(size_t(header.width) * header.height);
+    in.read((char *)m_glyphs.data(), m_glyphs.size() * sizeof(AtlasGlyph));
+    in.read((char *)m_pixels.data(), m_pixels.size());
+    if (!in) {
+        cout << "ERROR: Glyph atlas " << filename << " is truncated" << endl;
+        m_glyphs.clear();
+        m_pixels.clear();
+        return false;
+    }
+
+    m_pixelsPerEm = header.pixelsPerEm;
+    m_range = header.range;
+    m_width = header.width;
+    m_height = header.height;
+    return true;
+}
+
+double GlyphAtlas::LoadOrBuild(FontManager &fonts, int font, const vector<int> &codes,
+                               int pixelsPerEm, float range)
+{
+    const string &fontFile = fonts.FontFile(font);
+    string cacheFile = AtlasPath(fontFile, pixelsPerEm);
+
+    // usable if no older than the font, built with the same settings, and
+    // holding every character asked for
+    struct stat cacheInfo, fontInfo;
+    bool current = stat(cacheFile.c_str(), &cacheInfo) == 0 &&
+                   (stat(fontFile.c_str(), &fontInfo) != 0 || fontInfo.st_mtime <= cacheInfo.st_mtime);
+    if (current && Load(cacheFile) && m_range == range) {
+        bool covered = true;
+        for (size_t i = 0; covered && i < codes.size(); i++)
+            covered = Find(codes[i]) != 0;
+        if (covered)
+            return 0.0;
+    }
+
+    // keep whatever the old atlas held as well, so alternating between sets
+    // of text does not rebuild it every time
+    vector<int> wanted(codes);
+    for (size_t i = 0; i < m_glyphs.size() && m_pixelsPerEm == pixelsPerEm; i++)
+        wanted.push_back(m_glyphs[i].code);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Build(fonts, font, wanted, pixelsPerEm, range);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    Save(cacheFile);
+    return std::max(ms, 1e-3);
+}
+
+// --------------------------------------------------------------------------
+
+const AtlasGlyph *GlyphAtlas::Find(int code) const
+{
+    vector<AtlasGlyph>::const_iterator it = lower_bound(m_glyphs.begin(), m_glyphs.end(), code,
+        [](const AtlasGlyph &glyph, int c) { return glyph.code < c; });
+    if (it == m_glyphs.end() || it->code != code)
+        return 0;
+    return &*it;
+}
+
+float GlyphAtlas::Layout(FontManager &fonts, int font, const string &text, float size,
+                         vector<GlyphQuad> *quads) const
+{
+    vector<int> codes = DecodeUTF8(text);
+
+    float pen = 0.0f;
+    for (size_t i = 0; i < codes.size(); i++) {
+        if (i > 0)
+            pen += fonts.GetKerning(font, codes[i - 1], codes[i]) * size;
+
+        const AtlasGlyph *glyph = Find(codes[i]);
+        if (!glyph)
+            continue;
+
+        if (glyph->width > 0) {
+            GlyphQuad quad;
+            quad.plane = vec4(pen + glyph->left * size, glyph->bottom * size,
+                              pen + glyph->right * size, glyph->top * size);
+            quad.texels = vec4(glyph->x, glyph->y, glyph->width, glyph->height);
+            quads->push_back(quad);
+        }
+        pen += glyph->advance * size;
+    }
+    return pen;
+}
@@ -0,0 +1,96 @@
+// ==========================================================================
+// Signed Distance Field Glyph Atlas for Assignment 3
+//
+// Renders glyphs of a font into one single-channel texture in which each
+// texel holds its signed distance to the glyph outline, positive inside.
+// Distances are exact to the lines, quadratics and cubics of the outline
+// (closed form for lines and quadratics, Newton iteration for cubics), so
+// text drawn from the atlas stays sharp well above the size it was built
+// at. Glyphs are computed on several threads and packed in shelves, and a
+// finished atlas is saved next to the font so later runs only read it.
+//
+// Text drawn from an atlas is one textured quad per character, whatever
+// the complexity of the glyph.
+// ==========================================================================
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "FontManager.h"
+#include "GlyphOutline.h"
+
+// --------------------------------------------------------------------------
+
+// Where a glyph is in the atlas, and where its quad goes relative to the
+// pen, in EM units. Glyphs without an outline (spaces) have no texels.
+struct AtlasGlyph
+{
+    int code;
+    int x, y, width, height;           // texels, row 0 at the bottom
+    float left, bottom, right, top;    // quad bounds, EM units
+    float advance;
+};
+
+// One character of laid out text: its quad, and its texels in the atlas.
+struct GlyphQuad
+{
+    glm::vec4 plane;   // left, bottom, right, top
+    glm::vec4 texels;  // x, y, width, height
+};
+
+// the cache file for an atlas of a font at pixelsPerEm, next to the font
+std::string AtlasPath(const std::string &fontFile, int pixelsPerEm);
+
+// --------------------------------------------------------------------------
+
+class GlyphAtlas
+{
+    int m_pixelsPerEm;
+    float m_range;
+    int m_width;
+    int m_height;
+    std::vector<unsigned char> m_pixels;
+    std::vector<AtlasGlyph> m_glyphs;  // sorted by code
+
+public:
+    GlyphAtlas();
+
+    // Computes the distance fields of codes in a loaded font and packs
+    // them into an atlas width texels wide. A texel of 0 or 255 is range
+    // texels outside or inside the outline, and 128 is on it. threads is
+    // the number of threads used, 0 for one per core.
+    void Build(FontManager &fonts, int font, const std::vector<int> &codes, int pixelsPerEm,
+               float range, int width = 1024, int threads = 0);
+
+    // Reads the cached atlas for font if it was built with these settings
+    // for at least codes and is no older than the font, and builds and
+    // saves it otherwise. Returns the number of milliseconds spent building,
+    // 0 if the cache was used.
+    double LoadOrBuild(FontManager &fonts, int font, const std::vector<int> &codes,
+                       int pixelsPerEm, float range);
+
+    bool Save(const std::string &filename) const;
+    bool Load(const std::string &filename);
+
+    int PixelsPerEm() const { return m_pixelsPerEm; }
+    float Range() const { return m_range; }
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    const std::vector<unsigned char> &Pixels() const { return m_pixels; }
+    size_t GlyphCount() const { return m_glyphs.size(); }
+
+    // the glyph for code, or 0 if it is not in the atlas
+    const AtlasGlyph *Find(int code) const;
+
+    // Appends one quad per visible character of text set in font at size
+    // (the height of an EM) with its pen starting at the origin, and returns
+    // the width of the line. Characters missing from the atlas are skipped.
+    float Layout(FontManager &fonts, int font, const std::string &text, float size,
+                 std::vector<GlyphQuad> *quads) const;
+};
+
+// --------------------------------------------------------------------------
+#endif // GLYPHATLAS_H
@@ -0,0 +1,308 @@
+// ==========================================================================
+// Precompiled Glyph Bundles for Assignment 3
+// ==========================================================================
+
+#include "GlyphBundle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+static const char BUNDLE_MAGIC[4] = { 'A', '3', 'G', 'B' };
+
+bool operator<(const BundleGlyph &glyph, int code) { return glyph.code < code; }
+
+bool operator<(const BundleKerning &a, const BundleKerning &b)
+{
+    return a.left != b.left ? a.left < b.left : a.right < b.right;
+}
+
+// true if [first, first + count) lies within [0, total), without overflowing
+static bool InRange(unsigned int first, unsigned int count, unsigned int total)
+{
+    return count <= total && first <= total - count;
+}
+
+// true if every range of glyph lies inside the bundle's arrays, and every
+// segment and contour it holds stays inside the glyph's own point pool and
+// segment lists, so reading or drawing it cannot go past the file
+static bool ValidGlyph(const BundleGlyph &glyph, const BundleHeader &header,
+                       const unsigned int *segments, const ContourSpan *contours)
+{
+    if (!InRange(glyph.firstPoint, glyph.pointCount, header.pointCount) ||
+        !InRange(glyph.firstContour, glyph.contourCount, header.contourCount))
+        return false;
+
+    for (unsigned int d = 0; d < 4; d++) {
+        if (!InRange(glyph.firstSegment[d], glyph.segmentCount[d], header.segmentCount))
+            return false;
+        // a segment of degree d starting at i uses points i to i + d
+        const unsigned int *list = segments + glyph.firstSegment[d];
+        for (unsigned int i = 0; i < glyph.segmentCount[d]; i++) {
+            if (!InRange(list[i], d + 1, glyph.pointCount))
+                return false;
+        }
+    }
+
+    for (unsigned int c = 0; c < glyph.contourCount; c++) {
+        const ContourSpan &span = contours[glyph.firstContour + c];
+        if (span.pointCount == 0 || !InRange(span.firstPoint, span.pointCount, glyph.pointCount))
+            return false;
+        for (unsigned int d = 0; d < 4; d++) {
+            if (!InRange(span.firstSegment[d], span.segmentCount[d], glyph.segmentCount[d]))
+                return false;
+        }
+    }
+    return true;
+}
+
+string BundlePath(const string &fontFile)
+{
+    size_t dot = fontFile.find_last_of('.');
+    size_t slash = fontFile.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return fontFile + ".glyphs";
+    return fontFile.substr(0, dot) + ".glyphs";
+}
+
+// --------------------------------------------------------------------------
+
+bool WriteGlyphBundle(const string &filename, const vector<int> &codes,
+                      const vector<GlyphOutline> &outlines, const vector<BundleKerning> &kerning)
+{
+    vector<size_t> order(codes.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    sort(order.begin(), order.end(), [&codes](size_t a, size_t b) { return codes[a] < codes[b]; });
+
+    BundleHeader header;
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+    header.version = BUNDLE_VERSION;
+    header.glyphCount = codes.size();
+    header.kerningCount = kerning.size();
+    header.pointCount = 0;
+    header.segmentCount = 0;
+    header.contourCount = 0;
+
+    // the glyph table, with each glyph's place in the shared arrays
+    vector<BundleGlyph> glyphs(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const GlyphOutline &outline = outlines[order[i]];
+        BundleGlyph &glyph = glyphs[i];
+        glyph.code = codes[order[i]];
+        glyph.advance = outline.Advance();
+        glyph.firstPoint = header.pointCount;
+        glyph.pointCount = outline.Points().size();
+        header.pointCount += glyph.pointCount;
+        for (unsigned int d = 0; d < 4; d++) {
+            glyph.firstSegment[d] = header.segmentCount;
+            glyph.segmentCount[d] = outline.SegmentIndices(d).size();
+            header.segmentCount += glyph.segmentCount[d];
+        }
+        glyph.firstContour = header.contourCount;
+        glyph.contourCount = outline.ContourCount();
+        header.contourCount += glyph.contourCount;
+    }
+
+    vector<BundleKerning> pairs(kerning);
+    sort(pairs.begin(), pairs.end());
+
+    ofstream out(filename.c_str(), ios::binary);
+    if (!out) {
+        cout << "ERROR: Could not open " << filename << " for writing" << endl;
+        return false;
+    }
+
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)glyphs.data(), glyphs.size() * sizeof(BundleGlyph));
+    out.write((const char *)pairs.data(), pairs.size() * sizeof(BundleKerning));
+    for (size_t i = 0; i < order.size(); i++) {
+        const vector<vec2> &points = outlines[order[i]].Points();
+        out.write((const char *)points.data(), points.size() * sizeof(vec2));
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        for (unsigned int d = 0; d < 4; d++) {
+            const vector<unsigned int> &segments = outlines[order[i]].SegmentIndices(d);
+            out.write((const char *)segments.data(), segments.size() * sizeof(unsigned int));
+        }
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        const vector<ContourSpan> &contours = outlines[order[i]].Contours();
+        out.write((const char *)contours.data(), contours.size() * sizeof(ContourSpan));
+    }
+
+    if (!out) {
+        cout << "ERROR: Could not write " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+GlyphBundle::GlyphBundle()
+    : m_data(0), m_size(0), m_mapped(false), m_header(0), m_glyphs(0), m_kerning(0),
+      m_points(0), m_segments(0), m_contours(0)
+{
+}
+
+GlyphBundle::~GlyphBundle()
+{
+    Close();
+}
+
+void GlyphBundle::Close()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (m_mapped)
+        munmap((void *)m_data, m_size);
+#endif
+    m_buffer.clear();
+    m_data = 0;
+    m_size = 0;
+    m_mapped = false;
+    m_header = 0;
+}
+
+bool GlyphBundle::Open(const string &filename)
+{
+    Close();
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = (const char *)data;
+            m_size = info.st_size;
+            m_mapped = true;
+        }
+    }
+    close(fd);
+#else
+    ifstream in(filename.c_str(), ios::binary);
+    if (in) {
+        m_buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+#endif
+
+    if (!m_data)
+        return false;
+
+    // the tables are used in place, so the header has to match, the file
+    // has to be exactly as long as it says, and every glyph has to stay
+    // inside the arrays before any of it is read
+    const BundleHeader *header = (const BundleHeader *)m_data;
+    if (m_size < sizeof(BundleHeader) || memcmp(header->magic, BUNDLE_MAGIC, 4) != 0 ||
+        header->version != BUNDLE_VERSION) {
+        cout << "ERROR: " << filename << " is not a version " << BUNDLE_VERSION
+             << " glyph bundle" << endl;
+        Close();
+        return false;
+    }
+
+    size_t expected = sizeof(BundleHeader) + header->glyphCount * sizeof(BundleGlyph) +
+                      header->kerningCount * sizeof(BundleKerning) +
+                      header->pointCount * sizeof(vec2) +
+                      header->segmentCount * sizeof(unsigned int) +
+                      header->contourCount * sizeof(ContourSpan);
+    if (m_size != expected) {
+        cout << "ERROR: Glyph bundle " << filename << " is truncated or corrupt" << endl;
+        Close();
+        return false;
+    }
+
+    const BundleGlyph *glyphs = (const BundleGlyph *)(m_data + sizeof(BundleHeader));
+    const BundleKerning *kerning = (const BundleKerning *)(glyphs + header->glyphCount);
+    const vec2 *points = (const vec2 *)(kerning + header->kerningCount);
+    const unsigned int *segments = (const unsigned int *)(points + header->pointCount);
+    const ContourSpan *contours = (const ContourSpan *)(segments + header->segmentCount);
+
+    // both tables are binary searched, so they have to be in order too
+    for (unsigned int i = 0; i < header->glyphCount; i++) {
+        if ((i > 0 && glyphs[i - 1].code >= glyphs[i].code) ||
+            !ValidGlyph(glyphs[i], *header, segments, contours)) {
+            cout << "ERROR: Glyph bundle " << filename << " has a corrupt glyph table" << endl;
+            Close();
+            return false;
+        }
+    }
+    for (unsigned int i = 1; i < header->kerningCount; i++) {
+        if (!(kerning[i - 1] < kerning[i])) {
+            cout << "ERROR: Glyph bundle " << filename << " has a corrupt kerning table" << endl;
+            Close();
+            return false;
+        }
+    }
+
+    m_header = header;
+    m_glyphs = glyphs;
+    m_kerning = kerning;
+    m_points = points;
+    m_segments = segments;
+    m_contours = contours;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphBundle::ReadOutline(int character, GlyphOutline *outline) const
+{
+    outline->Clear();
+    if (!m_header)
+        return false;
+
+    const BundleGlyph *end = m_glyphs + m_header->glyphCount;
+    const BundleGlyph *glyph = lower_bound(m_glyphs, end, character);
+    if (glyph == end || glyph->code != character) {
+        glyph = lower_bound(m_glyphs, end, BUNDLE_MISSING_GLYPH);
+        if (glyph == end || glyph->code != BUNDLE_MISSING_GLYPH)
+            return false;
+    }
+
+    const unsigned int *segments[4];
+    size_t segmentCounts[4];
+    for (int d = 0; d < 4; d++) {
+        segments[d] = m_segments + glyph->firstSegment[d];
+        segmentCounts[d] = glyph->segmentCount[d];
+    }
+    outline->Assign(glyph->advance, m_points + glyph->firstPoint, glyph->pointCount,
+                    segments, segmentCounts, m_contours + glyph->firstContour,
+                    glyph->contourCount);
+    return true;
+}
+
+float GlyphBundle::GetKerning(int left, int right) const
+{
+    if (!m_header)
+        return 0.0f;
+
+    BundleKerning key;
+    key.left = left;
+    key.right = right;
+    const BundleKerning *end = m_kerning + m_header->kerningCount;
+    const BundleKerning *pair = lower_bound(m_kerning, end, key);
+    if (pair == end || pair->left != left || pair->right != right)
+        return 0.0f;
+    return pair->kerning;
+}
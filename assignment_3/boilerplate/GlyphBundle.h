@@ -0,0 +1,120 @@
+// ==========================================================================
+// Precompiled Glyph Bundles for Assignment 3
+//
+// A bundle holds every glyph outline of a font, with its advance width and
+// the font's non-zero kerning pairs, already in the layout GlyphOutline
+// uses. It is written by the bundle tool (tools/bundle.cpp) and mapped into
+// memory by GlyphBundle, so loading one is a check of its header and glyph
+// table and reading a glyph is a binary search and a copy, with no FreeType
+// involved.
+//
+// File layout, all fields 32 bits in native byte order:
+//     BundleHeader
+//     BundleGlyph[glyphCount]        sorted by code
+//     BundleKerning[kerningCount]    sorted by left, then right
+//     glm::vec2[pointCount]          point pools of every glyph
+//     unsigned int[segmentCount]     segment lists of every glyph
+//     ContourSpan[contourCount]      contour spans of every glyph
+// Each glyph's segment indices and contour spans are relative to its own
+// point pool and segment lists, as in a GlyphOutline.
+// ==========================================================================
+#ifndef GLYPHBUNDLE_H
+#define GLYPHBUNDLE_H
+
+#include <string>
+#include <vector>
+
+#include "GlyphOutline.h"
+
+// --------------------------------------------------------------------------
+
+const unsigned int BUNDLE_VERSION = 1;
+
+// the glyph a font draws for characters it has no glyph for (.notdef) is
+// stored under this code
+const int BUNDLE_MISSING_GLYPH = -1;
+
+struct BundleHeader
+{
+    char magic[4];  // "A3GB"
+    unsigned int version;
+    unsigned int glyphCount;
+    unsigned int kerningCount;
+    unsigned int pointCount;
+    unsigned int segmentCount;
+    unsigned int contourCount;
+};
+
+struct BundleGlyph
+{
+    int code;
+    float advance;
+    unsigned int firstPoint;
+    unsigned int pointCount;
+    unsigned int firstSegment[4];  // indexed by degree, [0] unused
+    unsigned int segmentCount[4];
+    unsigned int firstContour;
+    unsigned int contourCount;
+};
+
+struct BundleKerning
+{
+    int left;
+    int right;
+    float kerning;  // in EM units
+};
+
+// the bundle file kept next to a font file: its name with the extension
+// replaced by .glyphs
+std::string BundlePath(const std::string &fontFile);
+
+// Writes outlines[i] as the glyph for codes[i], with the given kerning
+// pairs, returning false if the file could not be written. The tables are
+// sorted here, so the inputs can be in any order.
+bool WriteGlyphBundle(const std::string &filename, const std::vector<int> &codes,
+                      const std::vector<GlyphOutline> &outlines,
+                      const std::vector<BundleKerning> &kerning);
+
+// --------------------------------------------------------------------------
+
+class GlyphBundle
+{
+    const char *m_data;
+    size_t m_size;
+    bool m_mapped;
+
+    // copy of the file where it cannot be mapped
+    std::vector<char> m_buffer;
+
+    const BundleHeader *m_header;
+    const BundleGlyph *m_glyphs;
+    const BundleKerning *m_kerning;
+    const glm::vec2 *m_points;
+    const unsigned int *m_segments;
+    const ContourSpan *m_contours;
+
+    GlyphBundle(const GlyphBundle &);
+    GlyphBundle &operator=(const GlyphBundle &);
+
+public:
+    GlyphBundle();
+    ~GlyphBundle();
+
+    // maps a bundle file, returning false if it is missing, not a bundle of
+    // this version, or has a glyph whose data falls outside the file
+    bool Open(const std::string &filename);
+    void Close();
+
+    size_t GlyphCount() const { return m_header ? m_header->glyphCount : 0; }
+
+    // Replaces the contents of outline with the glyph for character, or with
+    // the missing glyph if the font has none. Returns false if neither is in
+    // the bundle.
+    bool ReadOutline(int character, GlyphOutline *outline) const;
+
+    // horizontal kerning between two characters, in EM units
+    float GetKerning(int left, int right) const;
+};
+
+// --------------------------------------------------------------------------
+#endif // GLYPHBUNDLE_H
@@ -17,7 +17,19 @@
 // ==========================================================================
 
 #include "GlyphExtractor.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // set this true to print information about the font loaded and glyphs extracted
 #define DEBUG_PRINT 0
@@ -33,14 +45,31 @@ GlyphExtractor::GlyphExtractor()
     FT_Error error = FT_Init_FreeType(&m_library);
     if (error) {
         cout << "ERROR: FreeType failed to initialize!" << endl;
+        m_library = 0;
     }
 }
 
+GlyphExtractor::~GlyphExtractor()
+{
+    if (m_face)
+        FT_Done_Face(m_face);
+    if (m_library)
+        FT_Done_FreeType(m_library);
+}
+
 // --------------------------------------------------------------------------
 
 bool GlyphExtractor::LoadFontFile(const string &filename)
 {
+    // release any font loaded earlier
+    if (m_face) {
+        FT_Done_Face(m_face);
+        m_face = 0;
+    }
+
     FT_Error error = FT_New_Face(m_library, filename.c_str(), 0, &m_face);
+    if (error)
+        m_face = 0;
 
     if (error == FT_Err_Unknown_File_Format) {
         cout << "Freetype ERROR: unsupported file format in " << filename << endl;
@@ -56,6 +85,25 @@ bool GlyphExtractor::LoadFontFile(const string &filename)
     return true;
 }
 
+bool GlyphExtractor::LoadFontMemory(const unsigned char *data, size_t size)
+{
+    if (m_face) {
+        FT_Done_Face(m_face);
+        m_face = 0;
+    }
+
+    FT_Error error = FT_New_Memory_Face(m_library, data, size, 0, &m_face);
+    if (error) {
+        m_face = 0;
+        cout << "FreeType ERROR: could not load font from memory." << endl;
+        return false;
+    }
+
+    if (DEBUG_PRINT) PrintFontInformation();
+
+    return true;
+}
+
 // --------------------------------------------------------------------------
 
 void GlyphExtractor::PrintFontInformation() const
@@ -92,10 +140,37 @@ void GlyphExtractor::PrintGlyphInformation(int character) const
 
 MyGlyph GlyphExtractor::ExtractGlyph(int character) const
 {
+    GlyphOutline outline;
+    if (!ExtractOutline(character, &outline))
+        return MyGlyph();
+
+    // unpack each contour's segments from the outline, in order
+    MyGlyph glyph(outline.Advance());
+    glyph.contours.resize(outline.ContourCount());
+    for (size_t c = 0; c < outline.ContourCount(); ++c)
+    {
+        MyContour &contour = glyph.contours[c];
+        outline.VisitContour(c, [&contour](const SegmentView &view) {
+            MySegment segment(view.degree);
+            for (unsigned int i = 0; i <= view.degree; ++i) {
+                segment.x[i] = view[i].x;
+                segment.y[i] = view[i].y;
+            }
+            contour.push_back(segment);
+        });
+    }
+
+    return glyph;
+}
+
+bool GlyphExtractor::ExtractOutline(int character, GlyphOutline *glyph) const
+{
+    glyph->Clear();
+
     // first check that a font has been loaded
     if (!m_face) {
         cout << "GlyphExtractor ERROR: No font loaded!" << endl;
-        return MyGlyph();
+        return false;
     }
 
     // look up the glyph index for the given character code
@@ -108,15 +183,18 @@ MyGlyph GlyphExtractor::ExtractGlyph(int character) const
     {
         cout << "FreeType ERROR: Could not find glyph outline for character "
              << character << " (" << char(character) << ")" <<  endl;
-        return MyGlyph();
+        return false;
     }
 
     if (DEBUG_PRINT) PrintGlyphInformation(character);
 
-    // create a new glyph structure to populate with this character outline
+    // populate the outline with this character; a quadratic can add an
+    // implied on-curve point after each control point, and each contour
+    // repeats its first point, which bounds the size of the point pool
     FT_Outline &outline = m_face->glyph->outline;
     float em = m_face->units_per_EM;
-    MyGlyph glyph(m_face->glyph->advance.x / em);
+    glyph->SetAdvance(m_face->glyph->advance.x / em);
+    glyph->Reserve(2 * outline.n_points + outline.n_contours, outline.n_contours);
 
     // current point index
     int begin = 0;
@@ -124,8 +202,6 @@ MyGlyph GlyphExtractor::ExtractGlyph(int character) const
     // iterate through the outline's contours
     for (int c = 0; c < outline.n_contours; ++c)
     {
-        MyContour contour;
-
         // iterate through current contour's points
         int end = outline.contours[c];
         for (int p = begin; p <= end; ++p)
@@ -138,45 +214,41 @@ MyGlyph GlyphExtractor::ExtractGlyph(int character) const
             FT_Vector r_p = outline.points[p];
             FT_Vector r_q = outline.points[q];
 
-            // create a segment to store control points
-            MySegment segment;
-
-            if (outline.tags[p] & 1) {
-                segment.x[0] = r_p.x / em;
-                segment.y[0] = r_p.y / em;
-            }
-            else {
-                segment.x[0] = 0.5f * (r_p.x + r_q.x) / em;
-                segment.y[0] = 0.5f * (r_p.y + r_q.y) / em;
+            // the first segment starts the contour; later ones continue
+            // from the end point of the segment before
+            if (p == begin) {
+                if (outline.tags[p] & 1)
+                    glyph->BeginContour(glm::vec2(r_p.x, r_p.y) / em);
+                else
+                    glyph->BeginContour(0.5f * glm::vec2(r_p.x + r_q.x, r_p.y + r_q.y) / em);
             }
 
+            // control points after the start of the segment
+            glm::vec2 controls[3];
+
             // set degree of segment based on what the next point is
             if (outline.tags[q] & 1)
             {
                 // next point is on curve, so this is a line segment
-                segment.degree = 1;
-                segment.x[1] = r_q.x / em;
-                segment.y[1] = r_q.y / em;
+                controls[0] = glm::vec2(r_q.x, r_q.y) / em;
+                glyph->AddSegment(1, controls);
             }
             else if (outline.tags[q] & 2)
             {
                 // next point is third degree, so this is a cubic segment
-                segment.degree = 3;
                 for (int i = 0; i < 3; ++i)
                 {
-                    segment.x[1+i] = r_q.x / em;
-                    segment.y[1+i] = r_q.y / em;
+                    controls[i] = glm::vec2(r_q.x, r_q.y) / em;
                     if (++q > end) q = begin;
                     r_q = outline.points[q];
                 }
+                glyph->AddSegment(3, controls);
                 p += 2;
             }
             else
             {
                 // next point is second degree, so this is a quadratic segment
-                segment.degree = 2;
-                segment.x[1] = r_q.x / em;
-                segment.y[1] = r_q.y / em;
+                controls[0] = glm::vec2(r_q.x, r_q.y) / em;
 
                 // advance q
                 if (++q > end) q = begin;
@@ -184,29 +256,166 @@ MyGlyph GlyphExtractor::ExtractGlyph(int character) const
 
                 // if the next point is on curve, store and advance p
                 if (outline.tags[q] & 1) {
-                    segment.x[2] = r_q.x / em;
-                    segment.y[2] = r_q.y / em;
+                    controls[1] = glm::vec2(r_q.x, r_q.y) / em;
                     ++p;
                 }
                 // otherwise store the midpoint
                 else {
-                    segment.x[2] = 0.5f * (segment.x[1] + r_q.x / em);
-                    segment.y[2] = 0.5f * (segment.y[1] + r_q.y / em);
+                    controls[1] = 0.5f * (controls[0] + glm::vec2(r_q.x, r_q.y) / em);
                 }
+                glyph->AddSegment(2, controls);
             }
-
-            // add segment to contour
-            contour.push_back(segment);
         }
 
         // set beginning of next contour
         begin = end + 1;
+    }
 
-        // add contour to glyph
-        glyph.contours.push_back(contour);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+float GlyphExtractor::GetKerning(int left, int right) const
+{
+    if (!HasKerning())
+        return 0.0f;
+
+    FT_Vector delta;
+    FT_Error error = FT_Get_Kerning(m_face, FT_Get_Char_Index(m_face, left),
+                                    FT_Get_Char_Index(m_face, right),
+                                    FT_KERNING_UNSCALED, &delta);
+    if (error)
+        return 0.0f;
+
+    return delta.x / float(m_face->units_per_EM);
+}
+
+bool GlyphExtractor::HasKerning() const
+{
+    return m_face && FT_HAS_KERNING(m_face);
+}
+
+// --------------------------------------------------------------------------
+
+vector<int> GlyphExtractor::CharacterCodes() const
+{
+    vector<int> codes;
+    if (!m_face)
+        return codes;
+
+    FT_UInt index;
+    FT_ULong code = FT_Get_First_Char(m_face, &index);
+    while (index != 0) {
+        codes.push_back(code);
+        code = FT_Get_Next_Char(m_face, code, &index);
     }
+    return codes;
+}
 
-    return glyph;
+// --------------------------------------------------------------------------
+// Bulk extraction
+
+namespace {
+
+// a font file mapped read-only into memory, or read into a buffer where
+// mapping is not available
+class FontFileData
+{
+    const unsigned char *m_data;
+    size_t m_size;
+    bool m_mapped;
+    vector<unsigned char> m_buffer;
+
+    FontFileData(const FontFileData &);
+    FontFileData &operator=(const FontFileData &);
+
+public:
+    explicit FontFileData(const string &filename)
+        : m_data(0), m_size(0), m_mapped(false)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = (const unsigned char *)data;
+                m_size = info.st_size;
+                m_mapped = true;
+            }
+        }
+        close(fd);
+#else
+        ifstream in(filename.c_str(), ios::binary);
+        if (in) {
+            m_buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+        }
+#endif
+    }
+
+    ~FontFileData()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if (m_mapped)
+            munmap((void *)m_data, m_size);
+#endif
+    }
+
+    const unsigned char *Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+};
+
+}
+
+bool ExtractOutlines(const string &filename, const vector<int> &codes,
+                     vector<GlyphOutline> *outlines, int threads)
+{
+    outlines->clear();
+    outlines->resize(codes.size());
+
+    FontFileData file(filename);
+    if (!file.Data()) {
+        cout << "ERROR: Could not read font file " << filename << endl;
+        return false;
+    }
+
+    // Threads take blocks of characters in turn, which keeps them busy
+    // when some glyphs are far more complex than others, and write each
+    // outline straight into its place in the table. Blocks are small enough
+    // to share out a few hundred characters, large enough that the counter
+    // is not fought over.
+    const size_t BLOCK = 32;
+    atomic<size_t> next(0);
+    atomic<int> loaded(0);
+    auto work = [&]() {
+        GlyphExtractor extractor;
+        if (!extractor.LoadFontMemory(file.Data(), file.Size()))
+            return;
+        loaded++;
+        for (size_t first = next.fetch_add(BLOCK); first < codes.size();
+             first = next.fetch_add(BLOCK)) {
+            size_t last = std::min(first + BLOCK, codes.size());
+            for (size_t i = first; i < last; i++)
+                extractor.ExtractOutline(codes[i], &(*outlines)[i]);
+        }
+    };
+
+    if (threads <= 0)
+        threads = std::max(1u, thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, int((codes.size() + BLOCK - 1) / BLOCK)));
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.push_back(thread(work));
+    work();
+    for (size_t t = 0; t < pool.size(); t++)
+        pool[t].join();
+
+    return loaded > 0;
 }
 
 // --------------------------------------------------------------------------
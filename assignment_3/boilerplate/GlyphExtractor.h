@@ -11,6 +11,10 @@
 //
 // You may use this code (or not) however you see fit for your work.
 //
+// Glyphs can also be extracted as a GlyphOutline (see GlyphOutline.h), which
+// packs the same segments into a few flat arrays, and a whole character set
+// can be extracted at once on several threads with ExtractOutlines.
+//
 // Author:  Sonny Chan
 //          University of Calgary
 // Date:    February 2016
@@ -21,6 +25,8 @@
 #include <string>
 #include <vector>
 
+#include "GlyphOutline.h"
+
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
@@ -70,15 +76,48 @@ class GlyphExtractor
     void PrintFontInformation() const;
     void PrintGlyphInformation(int character) const;
 
+    // each extractor owns its library and face, so it cannot be copied
+    GlyphExtractor(const GlyphExtractor &);
+    GlyphExtractor &operator=(const GlyphExtractor &);
+
 public:
     GlyphExtractor();
+    ~GlyphExtractor();
 
     // call this method first to load a font file
     bool LoadFontFile(const std::string &filename);
 
+    // or this one, for a font file already in memory; the memory must stay
+    // valid until another font is loaded or the extractor is destroyed
+    bool LoadFontMemory(const unsigned char *data, size_t size);
+
     // this method retrieves a (possibly composite) glyph for the given character
     MyGlyph ExtractGlyph(int character) const;
+
+    // Replaces the contents of outline with the glyph for the given
+    // character, returning false (and an empty outline) if there is none.
+    // Reusing an outline with enough room does not allocate.
+    bool ExtractOutline(int character, GlyphOutline *outline) const;
+
+    // horizontal kerning between two characters, in EM units, from the
+    // font's kern table (0 if the font has none)
+    float GetKerning(int left, int right) const;
+    bool HasKerning() const;
+
+    // every character code the font's active charmap has a glyph for
+    std::vector<int> CharacterCodes() const;
 };
 
+// --------------------------------------------------------------------------
+
+// Extracts the outline of every character in codes from a font file into
+// outlines, in the same order, sharing the characters out between threads
+// (0 for one per core). A FreeType face cannot be used by two threads at
+// once, so each thread opens its own face on one copy of the file mapped
+// into memory. Characters the font lacks get empty outlines. Returns false
+// if the font could not be loaded.
+bool ExtractOutlines(const std::string &filename, const std::vector<int> &codes,
+                     std::vector<GlyphOutline> *outlines, int threads = 0);
+
 // --------------------------------------------------------------------------
 #endif // GLYPHEXTRACTOR_H
@@ -0,0 +1,75 @@
+// ==========================================================================
+// Compact Glyph Outlines for Assignment 3
+// ==========================================================================
+
+#include "GlyphOutline.h"
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+GlyphOutline::GlyphOutline()
+    : m_advance(0)
+{
+}
+
+void GlyphOutline::Clear()
+{
+    m_advance = 0;
+    m_points.clear();
+    for (int d = 0; d < 4; d++)
+        m_segments[d].clear();
+    m_contours.clear();
+}
+
+void GlyphOutline::Reserve(size_t points, size_t contours)
+{
+    m_points.reserve(points);
+    m_contours.reserve(contours);
+}
+
+void GlyphOutline::BeginContour(vec2 start)
+{
+    ContourSpan span;
+    span.firstPoint = m_points.size();
+    span.pointCount = 1;
+    for (int d = 0; d < 4; d++) {
+        span.firstSegment[d] = m_segments[d].size();
+        span.segmentCount[d] = 0;
+    }
+    m_contours.push_back(span);
+    m_points.push_back(start);
+}
+
+void GlyphOutline::AddSegment(unsigned int degree, const vec2 *controls)
+{
+    ContourSpan &span = m_contours.back();
+    m_segments[degree].push_back(m_points.size() - 1);
+    span.segmentCount[degree]++;
+
+    for (unsigned int i = 0; i < degree; i++)
+        m_points.push_back(controls[i]);
+    span.pointCount += degree;
+}
+
+void GlyphOutline::Assign(float advance, const vec2 *points, size_t pointCount,
+                          const unsigned int *const segments[4], const size_t segmentCounts[4],
+                          const ContourSpan *contours, size_t contourCount)
+{
+    m_advance = advance;
+    m_points.assign(points, points + pointCount);
+    for (int d = 0; d < 4; d++)
+        m_segments[d].assign(segments[d], segments[d] + segmentCounts[d]);
+    m_contours.assign(contours, contours + contourCount);
+}
+
+// --------------------------------------------------------------------------
+
+size_t GlyphOutline::MemoryUsed() const
+{
+    size_t bytes = m_points.size() * sizeof(vec2) + m_contours.size() * sizeof(ContourSpan);
+    for (int d = 0; d < 4; d++)
+        bytes += m_segments[d].size() * sizeof(unsigned int);
+    return bytes;
+}
@@ -0,0 +1,127 @@
+// ==========================================================================
+// Compact Glyph Outlines for Assignment 3
+//
+// A glyph outline packed into a few flat arrays, as a smaller alternative to
+// MyGlyph. The control points of every contour are stored back to back in
+// one point pool, with neighbouring segments sharing their endpoint and each
+// contour repeating its first point at the end, so a line costs one point
+// and a cubic three. Segments are listed separately for each degree by the
+// pool index of their first control point: a segment of degree d starting
+// at i has control points i to i + d.
+//
+// Filling an outline again reuses its arrays, so extracting into the same
+// outline does not allocate once it is big enough, and reading one never
+// does.
+// ==========================================================================
+#ifndef GLYPHOUTLINE_H
+#define GLYPHOUTLINE_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// --------------------------------------------------------------------------
+
+// Read-only view of one segment's control points inside an outline's pool.
+struct SegmentView
+{
+    unsigned int degree;      // 1=line, 2=quadratic, 3=cubic
+    const glm::vec2 *points;  // degree + 1 control points
+
+    SegmentView(unsigned int d, const glm::vec2 *p) : degree(d), points(p)
+    {}
+
+    const glm::vec2 &operator[](int i) const { return points[i]; }
+};
+
+// The points of one contour, and the range of its segments in each of the
+// per-degree segment lists.
+struct ContourSpan
+{
+    unsigned int firstPoint;
+    unsigned int pointCount;
+    unsigned int firstSegment[4];  // indexed by degree, [0] unused
+    unsigned int segmentCount[4];
+};
+
+class GlyphOutline
+{
+    float m_advance;
+    std::vector<glm::vec2> m_points;
+    std::vector<unsigned int> m_segments[4];
+    std::vector<ContourSpan> m_contours;
+
+public:
+    GlyphOutline();
+
+    // ---- building, used by GlyphExtractor::ExtractOutline
+
+    // empties the outline, keeping its memory
+    void Clear();
+    void Reserve(size_t points, size_t contours);  // pool points and contours
+    void SetAdvance(float advance) { m_advance = advance; }
+
+    // starts a contour at start; each segment added to it continues from
+    // the end of the one before, so only its remaining control points are
+    // given (degree of them, the last being its end point)
+    void BeginContour(glm::vec2 start);
+    void AddSegment(unsigned int degree, const glm::vec2 *controls);
+
+    // replaces the contents with arrays in the layout this class keeps,
+    // as written out by Points(), SegmentIndices() and Contours()
+    void Assign(float advance, const glm::vec2 *points, size_t pointCount,
+                const unsigned int *const segments[4], const size_t segmentCounts[4],
+                const ContourSpan *contours, size_t contourCount);
+
+    // ---- reading
+
+    // advance width to the next glyph, in EM units
+    float Advance() const { return m_advance; }
+
+    size_t ContourCount() const { return m_contours.size(); }
+    const ContourSpan &Contour(size_t c) const { return m_contours[c]; }
+    const glm::vec2 *ContourPoints(size_t c) const { return &m_points[m_contours[c].firstPoint]; }
+
+    // segments of one degree across all contours, in contour order
+    size_t SegmentCount(unsigned int degree) const { return m_segments[degree].size(); }
+    SegmentView Segment(unsigned int degree, size_t i) const {
+        return SegmentView(degree, &m_points[m_segments[degree][i]]);
+    }
+
+    // the whole point pool, in EM-box coordinates, and the raw segment
+    // lists and contour spans that index into it
+    const std::vector<glm::vec2> &Points() const { return m_points; }
+    const std::vector<unsigned int> &SegmentIndices(unsigned int degree) const { return m_segments[degree]; }
+    const std::vector<ContourSpan> &Contours() const { return m_contours; }
+
+    // calls visit(SegmentView) for each segment of contour c in order along
+    // the contour, merging the per-degree lists
+    template <typename Visit>
+    void VisitContour(size_t c, Visit visit) const {
+        const ContourSpan &span = m_contours[c];
+        unsigned int next[4];
+        for (int d = 1; d <= 3; d++)
+            next[d] = span.firstSegment[d];
+
+        unsigned int point = span.firstPoint;
+        unsigned int last = span.firstPoint + span.pointCount - 1;
+        while (point < last) {
+            unsigned int degree = 1;
+            for (int d = 1; d <= 3; d++) {
+                if (next[d] < span.firstSegment[d] + span.segmentCount[d] &&
+                    m_segments[d][next[d]] == point) {
+                    degree = d;
+                    break;
+                }
+            }
+            next[degree]++;
+            visit(SegmentView(degree, &m_points[point]));
+            point += degree;
+        }
+    }
+
+    // total bytes of outline data held, for comparing with MyGlyph
+    size_t MemoryUsed() const;
+};
+
+// --------------------------------------------------------------------------
+#endif // GLYPHOUTLINE_H
@@ -0,0 +1,157 @@
+// ==========================================================================
+// Text Layout for Assignment 3
+// ==========================================================================
+
+#include "TextLayout.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+void PatchLists::Clear()
+{
+    for (int d = 0; d < 4; d++) {
+        points[d].clear();
+        colours[d].clear();
+    }
+}
+
+// patches are independent of each other, so the segments are taken a
+// degree at a time rather than along each contour
+void AppendGlyphPatches(const GlyphOutline &glyph, vec2 origin, float size, PatchLists *patches)
+{
+    for (unsigned int degree = 1; degree <= 3; degree++) {
+        vector<vec2> &points = patches->points[degree];
+        for (size_t i = 0; i < glyph.SegmentCount(degree); i++) {
+            SegmentView segment = glyph.Segment(degree, i);
+            for (unsigned int k = 0; k <= degree; k++)
+                points.push_back(segment[k] * size + origin);
+        }
+        patches->colours[degree].resize(points.size(), vec3(1.0f, 1.0f, 1.0f));
+    }
+}
+
+vector<int> DecodeUTF8(const string &text)
+{
+    vector<int> codes;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = text[i];
+        int length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3 : (c >> 3) == 0x1e ? 4 : 0;
+        int code = length == 1 ? c : length == 2 ? c & 0x1f : length == 3 ? c & 0x0f : c & 0x07;
+
+        bool valid = length > 0 && i + length <= text.size();
+        for (int k = 1; valid && k < length; k++) {
+            unsigned char next = text[i + k];
+            valid = (next & 0xc0) == 0x80;
+            code = (code << 6) | (next & 0x3f);
+        }
+
+        if (valid) {
+            codes.push_back(code);
+            i += length;
+        } else {
+            codes.push_back(0xfffd);
+            i++;
+        }
+    }
+    return codes;
+}
+
+// --------------------------------------------------------------------------
+
+size_t TextLine::SegmentCount(int degree) const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < runs.size(); i++)
+        count += runs[i].count[degree] / (degree + 1) * runs[i].instanceCount;
+    return count;
+}
+
+// --------------------------------------------------------------------------
+
+bool TextLayout::Key::operator<(const Key &other) const
+{
+    if (font != other.font)
+        return font < other.font;
+    if (size != other.size)
+        return size < other.size;
+    return text < other.text;
+}
+
+TextLayout::TextLayout(FontManager &fonts)
+    : m_fonts(fonts)
+{
+}
+
+const TextLayout::Range &TextLayout::GlyphPatches(int font, int character)
+{
+    unsigned long long key = (unsigned long long)font << 32 | (unsigned int)character;
+    unordered_map<unsigned long long, Range>::iterator it = m_ranges.find(key);
+    if (it != m_ranges.end())
+        return it->second;
+
+    Range &range = m_ranges[key];
+    for (int d = 0; d < 4; d++)
+        range.first[d] = m_patches.points[d].size();
+    AppendGlyphPatches(m_fonts.GetOutline(font, character), vec2(0.0f, 0.0f), 1.0f, &m_patches);
+    for (int d = 0; d < 4; d++)
+        range.count[d] = m_patches.points[d].size() - range.first[d];
+    return range;
+}
+
+const TextLine &TextLayout::Layout(const string &text, int font, float size)
+{
+    Key key;
+    key.text = text;
+    key.font = font;
+    key.size = size;
+
+    map<Key, TextLine>::iterator it = m_lines.find(key);
+    if (it != m_lines.end())
+        return it->second;
+
+    TextLine &line = m_lines[key];
+    line.size = size;
+    vector<int> codes = DecodeUTF8(text);
+
+    // pen position of every visible character with its glyph's patches,
+    // sorted so that each glyph becomes one run
+    vector<pair<const Range *, vec2> > placed;
+    float pen = 0.0f;
+    for (size_t i = 0; i < codes.size(); i++) {
+        if (i > 0)
+            pen += m_fonts.GetKerning(font, codes[i - 1], codes[i]) * size;
+
+        const Range &range = GlyphPatches(font, codes[i]);
+        if (range.count[1] + range.count[2] + range.count[3] > 0)
+            placed.push_back(make_pair(&range, vec2(pen, 0.0f)));
+        pen += m_fonts.GetOutline(font, codes[i]).Advance() * size;
+    }
+    line.width = pen;
+
+    stable_sort(placed.begin(), placed.end(),
+                [](const pair<const Range *, vec2> &a, const pair<const Range *, vec2> &b) {
+                    return a.first < b.first;
+                });
+
+    for (size_t i = 0; i < placed.size(); i++) {
+        if (i == 0 || placed[i].first != placed[i - 1].first) {
+            GlyphRun run;
+            for (int d = 0; d < 4; d++) {
+                run.first[d] = placed[i].first->first[d];
+                run.count[d] = placed[i].first->count[d];
+            }
+            run.firstInstance = i;
+            run.instanceCount = 0;
+            line.runs.push_back(run);
+        }
+        line.runs.back().instanceCount++;
+        line.pens.push_back(placed[i].second);
+    }
+
+    return line;
+}
@@ -0,0 +1,124 @@
+// ==========================================================================
+// Text Layout for Assignment 3
+//
+// Lays a line of UTF-8 text out along a baseline using the advance width of
+// each glyph and the kerning between neighbouring characters. The Bezier
+// patches of each glyph are stored once, in EM units, in a buffer shared by
+// every line; a line is just the pen position of each character, grouped
+// into runs of the same glyph so it can be drawn as instances of those
+// patches. Vertex memory grows with the number of distinct glyphs, not the
+// number of characters. Finished lines are kept, keyed by text, font and
+// size, so text that has not changed is never laid out again.
+//
+// Patches are kept apart by degree, each glyph's lines, quadratics and
+// cubics in their own list, so that lines are drawn as plain lines and each
+// degree of curve goes to a tessellation program made for its patch size.
+// TrueType (quadratic) and CFF (cubic) outlines are drawn as they are.
+// ==========================================================================
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "FontManager.h"
+
+// --------------------------------------------------------------------------
+
+// Control points of Bezier segments split by degree: lines (2 points each),
+// quadratics (3) and cubics (4) in the lists of index 1, 2 and 3.
+struct PatchLists
+{
+    std::vector<glm::vec2> points[4];
+    std::vector<glm::vec3> colours[4];
+
+    void Clear();
+
+    size_t SegmentCount(int degree) const { return points[degree].size() / (degree + 1); }
+};
+
+// The characters of a line showing one glyph: count[d] control points from
+// first[d] in list d of the shared patches, drawn once for each of
+// instanceCount pen positions starting at firstInstance.
+struct GlyphRun
+{
+    int first[4];
+    int count[4];
+    size_t firstInstance;
+    size_t instanceCount;
+};
+
+// A line of text with its pen starting at the origin and the baseline along
+// y = 0. Glyph patches are scaled by size and then moved to a pen position.
+struct TextLine
+{
+    std::vector<glm::vec2> pens;
+    std::vector<GlyphRun> runs;
+    float size;
+
+    // distance from the origin to the pen position after the last character
+    float width;
+
+    TextLine() : size(1), width(0)
+    {}
+
+    // number of segments of a degree drawn for the whole line
+    size_t SegmentCount(int degree) const;
+};
+
+// appends the segments of glyph, scaled by size and placed at origin, to the
+// list of their degree
+void AppendGlyphPatches(const GlyphOutline &glyph, glm::vec2 origin, float size,
+                        PatchLists *patches);
+
+// decodes UTF-8 text into code points, replacing malformed bytes by U+FFFD
+std::vector<int> DecodeUTF8(const std::string &text);
+
+// --------------------------------------------------------------------------
+
+class TextLayout
+{
+    struct Key {
+        std::string text;
+        int font;
+        float size;
+
+        bool operator<(const Key &other) const;
+    };
+
+    FontManager &m_fonts;
+    std::map<Key, TextLine> m_lines;
+
+    // patches of every glyph laid out so far, with their place in each list
+    // of m_patches keyed by font in the upper 32 bits and character code in
+    // the lower
+    struct Range {
+        int first[4];
+        int count[4];
+    };
+    std::unordered_map<unsigned long long, Range> m_ranges;
+    PatchLists m_patches;
+
+    const Range &GlyphPatches(int font, int character);
+
+    TextLayout(const TextLayout &);
+    TextLayout &operator=(const TextLayout &);
+
+public:
+    explicit TextLayout(FontManager &fonts);
+
+    // returns text set in a loaded font at size (the height of an EM), laying
+    // it out only the first time this combination is asked for
+    const TextLine &Layout(const std::string &text, int font, float size);
+
+    // the shared patches the runs of every line refer to, in EM units with
+    // each glyph's origin at 0. They only grow, when a line uses a glyph no
+    // earlier line did.
+    const PatchLists &Patches() const { return m_patches; }
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTLAYOUT_H
@@ -0,0 +1,148 @@
+// ==========================================================================
+// Virtualized Document View for Assignment 3
+// ==========================================================================
+
+#include "TextView.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "TextLayout.h"
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+TextView::TextView(FontManager &fonts, const GlyphAtlas &atlas, int font, float size,
+                   float wrapWidth, float lineHeight, int slots, int slotCapacity)
+    : m_fonts(fonts), m_atlas(atlas), m_font(font), m_size(size), m_wrapWidth(wrapWidth),
+      m_lineHeight(lineHeight), m_slotCapacity(slotCapacity), m_next(0), m_wrapped(true),
+      m_slotLines(slots, -1), m_slotQuads(slots)
+{
+    for (int i = 0; i < slots; i++)
+        m_slotQuads[i].reserve(slotCapacity);
+}
+
+void TextView::SetText(const string &text)
+{
+    m_text = text;
+    m_codes = DecodeUTF8(text);
+    m_lineStarts.clear();
+    m_next = 0;
+    m_wrapped = m_codes.empty();
+    fill(m_slotLines.begin(), m_slotLines.end(), -1);
+}
+
+// --------------------------------------------------------------------------
+
+void TextView::WrapUntil(size_t line)
+{
+    size_t n = m_codes.size();
+    while (!m_wrapped && m_lineStarts.size() <= line) {
+        size_t start = m_next;
+        m_lineStarts.push_back(start);
+
+        // a line ends at a newline, after the last space that fits, or, for
+        // a word too long for a line of its own, at the character that does
+        // not fit; it never holds more characters than fit in a slot
+        size_t space = n;
+        size_t i = start;
+        float pen = 0.0f;
+        m_next = n;
+        for (; i < n; i++) {
+            int code = m_codes[i];
+            if (code == '\n') {
+                m_next = i + 1;
+                break;
+            }
+            if (i - start == (size_t)m_slotCapacity) {
+                m_next = space < n ? space + 1 : i;
+                break;
+            }
+            if (i > start)
+                pen += m_fonts.GetKerning(m_font, m_codes[i - 1], code) * m_size;
+
+            const AtlasGlyph *glyph = m_atlas.Find(code);
+            if (!glyph)
+                continue;
+            if (code == ' ') {
+                space = i;
+            } else if (i > start && pen + glyph->right * m_size > m_wrapWidth) {
+                m_next = space < n ? space + 1 : i;
+                break;
+            }
+            pen += glyph->advance * m_size;
+        }
+
+        if (m_next >= n)
+            m_wrapped = true;
+    }
+}
+
+void TextView::LayoutLine(size_t line, vector<GlyphQuad> *quads) const
+{
+    quads->clear();
+    size_t start = m_lineStarts[line];
+    size_t end = line + 1 < m_lineStarts.size() ? m_lineStarts[line + 1] : m_next;
+
+    // the baseline is one EM below the top of the line
+    float baseline = -(line * m_lineHeight + m_size);
+    float pen = 0.0f;
+    for (size_t i = start; i < end; i++) {
+        if (i > start)
+            pen += m_fonts.GetKerning(m_font, m_codes[i - 1], m_codes[i]) * m_size;
+
+        const AtlasGlyph *glyph = m_atlas.Find(m_codes[i]);
+        if (!glyph)
+            continue;
+
+        if (glyph->width > 0 && quads->size() < (size_t)m_slotCapacity) {
+            GlyphQuad quad;
+            quad.plane = vec4(pen + glyph->left * m_size, baseline + glyph->bottom * m_size,
+                              pen + glyph->right * m_size, baseline + glyph->top * m_size);
+            quad.texels = vec4(glyph->x, glyph->y, glyph->width, glyph->height);
+            quads->push_back(quad);
+        }
+        pen += glyph->advance * m_size;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void TextView::Update(float scroll, float height, int margin)
+{
+    m_dirty.clear();
+    m_visible.clear();
+
+    long slots = m_slotLines.size();
+    long top = (long)floor(scroll / m_lineHeight);
+    long bottom = (long)floor((scroll + height) / m_lineHeight);
+    long first = std::max(top - margin, 0L);
+    long last = std::min(bottom + margin, first + slots - 1);
+    if (last < first)
+        return;
+
+    WrapUntil(last);
+    last = std::min(last, (long)m_lineStarts.size() - 1);
+
+    // Line i always goes in slot i % slots. The resident lines are a run of
+    // no more than slots lines, so they never share a slot, and a line
+    // coming into view lands on one that has just left it.
+    for (long line = first; line <= last; line++) {
+        int slot = line % slots;
+        if (m_slotLines[slot] != line) {
+            m_slotLines[slot] = line;
+            LayoutLine(line, &m_slotQuads[slot]);
+            m_dirty.push_back(slot);
+        }
+
+        // only the lines actually in view are drawn
+        if (line >= top && line <= bottom && !m_slotQuads[slot].empty()) {
+            ViewSlot visible;
+            visible.slot = slot;
+            visible.count = m_slotQuads[slot].size();
+            m_visible.push_back(visible);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+// ==========================================================================
+// Virtualized Document View for Assignment 3
+//
+// Shows a long document as filled text from a GlyphAtlas, scrolled
+// vertically. Lines are wrapped lazily, only as far down as the view has
+// scrolled, and only the lines in view plus a margin have quads. Those live
+// in a fixed number of slots of a GPU buffer; a line scrolling into view
+// takes over the slot of one that has left, so per frame work and memory
+// depend on the size of the view, not the length of the document.
+//
+// The view itself does no OpenGL calls: after Update, the caller uploads
+// the quads of each dirty slot to slot * SlotCapacity() quads into its
+// instance buffer, and draws the visible slots.
+// ==========================================================================
+#ifndef TEXTVIEW_H
+#define TEXTVIEW_H
+
+#include <string>
+#include <vector>
+
+#include "FontManager.h"
+#include "GlyphAtlas.h"
+
+// --------------------------------------------------------------------------
+
+// a slot to draw, holding count quads
+struct ViewSlot
+{
+    int slot;
+    int count;
+};
+
+class TextView
+{
+    FontManager &m_fonts;
+    const GlyphAtlas &m_atlas;
+    int m_font;
+    float m_size;
+    float m_wrapWidth;
+    float m_lineHeight;
+    int m_slotCapacity;
+
+    std::string m_text;
+    std::vector<int> m_codes;
+
+    // start of each line wrapped so far, in code points, and of the next;
+    // wrapping resumes from there when a later line is needed
+    std::vector<size_t> m_lineStarts;
+    size_t m_next;
+    bool m_wrapped;
+
+    // the line each slot holds (-1 for none), with its quads
+    std::vector<long> m_slotLines;
+    std::vector<std::vector<GlyphQuad> > m_slotQuads;
+
+    std::vector<int> m_dirty;
+    std::vector<ViewSlot> m_visible;
+
+    TextView(const TextView &);
+    TextView &operator=(const TextView &);
+
+    // wraps lines until line is known or the document ends
+    void WrapUntil(size_t line);
+    void LayoutLine(size_t line, std::vector<GlyphQuad> *quads) const;
+
+public:
+    // text set in a font of the atlas at size (the height of an EM),
+    // wrapped to wrapWidth with lineHeight between baselines, in slots of
+    // at most slotCapacity characters per line
+    TextView(FontManager &fonts, const GlyphAtlas &atlas, int font, float size,
+             float wrapWidth, float lineHeight, int slots, int slotCapacity);
+
+    void SetText(const std::string &text);
+
+    // Brings the lines between scroll and scroll + height below the top of
+    // the document, and margin lines either side, into slots. Lines moved
+    // into a slot are listed by DirtySlots until the next Update.
+    void Update(float scroll, float height, int margin);
+
+    const std::vector<int> &DirtySlots() const { return m_dirty; }
+    const std::vector<GlyphQuad> &SlotQuads(int slot) const { return m_slotQuads[slot]; }
+    const std::vector<ViewSlot> &VisibleSlots() const { return m_visible; }
+
+    int SlotCount() const { return m_slotLines.size(); }
+    int SlotCapacity() const { return m_slotCapacity; }
+    float LineHeight() const { return m_lineHeight; }
+
+    // number of lines wrapped so far, and whether that is all of them
+    size_t LinesWrapped() const { return m_lineStarts.size(); }
+    bool FullyWrapped() const { return m_wrapped; }
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTVIEW_H
@@ -31,6 +31,10 @@
 
 #include "texture.h"
 #include "GlyphExtractor.h"
+#include "FontManager.h"
+#include "GlyphAtlas.h"
+#include "TextView.h"
+#include "TextLayout.h"
 
 using namespace std;
 using namespace glm;
@@ -42,7 +46,8 @@ bool CheckGLErrors();
 
 string LoadSource(const string &filename);
 GLuint CompileShader(GLenum shaderType, const string &source);
-GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader);
+GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader,
+                   GLuint geometryShader = 0);
 
 int scene = 1;
 int font = 1;
@@ -51,46 +56,132 @@ int degree = 3;
 float resetTime = 16.0f;
 float scrollSpeed = 0.0f;
 
+// largest distance in pixels tessellated curves may stray from the true
+// curve, and whether it is used (otherwise every patch gets 64 segments)
+float tessTolerance = 0.25f;
+bool adaptiveTess = true;
+
+// Curves are anti-aliased either by analytic coverage, each segment drawn
+// as a quad whose fragments measure their distance to it, straight into
+// the single sample window, or as plain lines into a multisampled
+// framebuffer resolved to the window afterwards.
+bool analyticAA = true;
+const int MSAA_SAMPLES = 4;
+const float STROKE_WIDTH = 1.0f;
+
+// fonts and glyph outlines, loaded once and shared by every frame
+FontManager fontManager;
+TextLayout textLayout(fontManager);
+
+string sentence = "The quick brown fox jumped over the lazy dog.";
+
+// distance field atlases of the scrolling fonts for filled text (scene 4),
+// built or read from their cache the first time each font is shown
+const int ATLAS_PIXELS_PER_EM = 48;
+const float ATLAS_RANGE = 4.0f;
+GlyphAtlas atlases[3];
+MyTexture atlasTextures[3];
+
+// the long document scrolled in scene 5, read from the file named on the
+// command line or generated, and its view; text is set at DOCUMENT_SIZE and
+// wrapped to the window, and the view keeps the lines on screen and
+// DOCUMENT_MARGIN lines above and below them in DOCUMENT_SLOTS slots of
+// DOCUMENT_SLOT_CAPACITY quads
+const float DOCUMENT_SIZE = 0.08f;
+const float DOCUMENT_LINE_HEIGHT = 1.25f * DOCUMENT_SIZE;
+const int DOCUMENT_MARGIN = 4;
+const int DOCUMENT_SLOTS = 32;
+const int DOCUMENT_SLOT_CAPACITY = 128;
+string documentFile;
+string documentText;
+TextView *documentView = 0;
+
 // --------------------------------------------------------------------------
 // Functions to set up OpenGL shader programs for rendering
 
-// load, compile, and link shaders, returning true if successful
-void InitializeShaders(GLuint* program1, GLuint* program2)
+// source with "#define name value" added after its #version line, so that
+// one shader file can be compiled into variants
+string DefineInSource(const string &source, const string &name, int value)
+{
+	string define = "#define " + name + " " + to_string(value) + "\n";
+	size_t version = source.find("#version");
+	size_t line = version == string::npos ? string::npos : source.find('\n', version);
+	if (line == string::npos)
+		return define + source;
+	return source.substr(0, line + 1) + define + source.substr(line + 1);
+}
+
+// load, compile, and link shaders, returning true if successful. Outlines
+// get one program per segment degree, with DEGREE defined in each: lines
+// (1) are drawn without tessellation, and quadratics (2) and cubics (3) are
+// tessellated by stages made for their patch size. strokePrograms are the
+// same with a geometry stage added, for analytic coverage.
+void InitializeShaders(GLuint programs[4], GLuint strokePrograms[4], GLuint* program2)
 {
 	// load shader source from files
 	string vertexSource = LoadSource("shaders/vertex.glsl");
 	string fragmentSource = LoadSource("shaders/fragment.glsl");
 	string tcsSource = LoadSource("shaders/tessControl.glsl");
 	string tesSource = LoadSource("shaders/tessEval.glsl");
+	string strokeGeometrySource = LoadSource("shaders/strokeGeometry.glsl");
+	string strokeFragmentSource = LoadSource("shaders/strokeFragment.glsl");
 
         string vertexSource2 = LoadSource("shaders/vertex2.glsl");
         string fragmentSource2 = LoadSource("shaders/fragment2.glsl");
 
 	if (vertexSource.empty() || fragmentSource.empty()) return;
+	if (tcsSource.empty() || tesSource.empty()) return;
+	if (strokeGeometrySource.empty() || strokeFragmentSource.empty()) return;
         if (vertexSource2.empty() || fragmentSource2.empty()) return;
 
-	// compile shader source into shader objects
-	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	// compile shader source into shader objects, and link shader programs
 	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
-	GLuint tcs = CompileShader(GL_TESS_CONTROL_SHADER, tcsSource);
-	GLuint tes = CompileShader(GL_TESS_EVALUATION_SHADER, tesSource);
+	GLuint strokeGeometry = CompileShader(GL_GEOMETRY_SHADER, strokeGeometrySource);
+	GLuint strokeFragment = CompileShader(GL_FRAGMENT_SHADER, strokeFragmentSource);
+	for (int d = 1; d <= 3; d++) {
+		GLuint vertex = CompileShader(GL_VERTEX_SHADER,
+		                              DefineInSource(vertexSource, "DEGREE", d));
+		GLuint tcs = 0, tes = 0;
+		if (d > 1) {
+			tcs = CompileShader(GL_TESS_CONTROL_SHADER,
+			                    DefineInSource(tcsSource, "DEGREE", d));
+			tes = CompileShader(GL_TESS_EVALUATION_SHADER,
+			                    DefineInSource(tesSource, "DEGREE", d));
+		}
+		programs[d] = LinkProgram(vertex, fragment, tcs, tes);
+		strokePrograms[d] = LinkProgram(vertex, strokeFragment, tcs, tes, strokeGeometry);
+
+		glDeleteShader(vertex);
+		glDeleteShader(tcs);
+		glDeleteShader(tes);
+	}
+	glDeleteShader(fragment);
+	glDeleteShader(strokeGeometry);
+	glDeleteShader(strokeFragment);
 
         GLuint vertex2 = CompileShader(GL_VERTEX_SHADER, vertexSource2);
         GLuint fragment2 = CompileShader(GL_FRAGMENT_SHADER, fragmentSource2);
+        *program2 = LinkProgram(vertex2, fragment2, 0, 0);
+        glDeleteShader(vertex2);
+        glDeleteShader(fragment2);
 
-	if (CheckGLErrors())
-		return;
+	CheckGLErrors();
+}
 
-	// link shader program
-        *program1 = LinkProgram(vertex, fragment, tcs, tes);
-        *program2 = LinkProgram(vertex2, fragment2, 0, 0);
+// the program drawing text from a distance field atlas, 0 if it failed
+GLuint InitializeAtlasShader()
+{
+	string vertexSource = LoadSource("shaders/sdfVertex.glsl");
+	string fragmentSource = LoadSource("shaders/sdfFragment.glsl");
+	if (vertexSource.empty() || fragmentSource.empty()) return 0;
+
+	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	GLuint program = LinkProgram(vertex, fragment, 0, 0);
 
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
-        glDeleteShader(vertex2);
-        glDeleteShader(fragment2);
-	glDeleteShader(tcs);
-	glDeleteShader(tes);
+	return program;
 }
 
 // --------------------------------------------------------------------------
@@ -102,15 +193,26 @@ struct Geometry
 	GLuint  vertexBuffer;
 	GLuint  textureBuffer;
 	GLuint  colourBuffer;
+	GLuint  instanceBuffer;
 	GLuint  vertexArray;
 	GLsizei elementCount;
 
+	// outline geometry holds its lines, quadratics and cubics one after the
+	// other: batchCount[d] vertices of degree d from batchFirst[d]
+	GLint   batchFirst[4];
+	GLsizei batchCount[4];
+
 	// initialize object names to zero (OpenGL reserved value)
-	Geometry() : vertexBuffer(0), colourBuffer(0), vertexArray(0), elementCount(0)
+	Geometry() : vertexBuffer(0), colourBuffer(0), instanceBuffer(0), vertexArray(0),
+	             elementCount(0), batchFirst(), batchCount()
 	{}
 };
 
-bool InitializeVAO(Geometry *geometry){
+const GLuint INSTANCE_INDEX = 2;
+
+// instanced geometry also gets a buffer of per-instance pen positions, read
+// once per instance by the InstancePosition attribute
+bool InitializeVAO(Geometry *geometry, bool instanced = false){
 
 	const GLuint VERTEX_INDEX = 0;
 	const GLuint COLOUR_INDEX = 1;
@@ -149,6 +251,17 @@ bool InitializeVAO(Geometry *geometry){
 		0);					//Offset to first element
 	glEnableVertexAttribArray(COLOUR_INDEX);
 
+	// associate the pen positions with the vertex array object, advancing
+	// once per instance rather than per vertex; the offset is set per glyph
+	// when drawing
+	if (instanced) {
+		glGenBuffers(1, &geometry->instanceBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, geometry->instanceBuffer);
+		glVertexAttribPointer(INSTANCE_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+		glVertexAttribDivisor(INSTANCE_INDEX, 1);
+		glEnableVertexAttribArray(INSTANCE_INDEX);
+	}
+
 	// unbind our buffers, resetting to default state
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
@@ -178,6 +291,135 @@ bool LoadGeometry(Geometry *geometry, vec2 *vertices, vec3 *colours, int element
 	return !CheckGLErrors();
 }
 
+// fill the instance buffer with pen positions, returning true if successful
+bool LoadInstances(Geometry *geometry, const vector<vec2> &pens)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2)*pens.size(), pens.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return !CheckGLErrors();
+}
+
+// Sets up geometry for text drawn as textured quads: a unit square drawn as
+// a triangle strip, and per instance the GlyphQuad of one character.
+const GLuint CORNER_INDEX = 0;
+const GLuint PLANE_INDEX = 1;
+const GLuint TEXELS_INDEX = 2;
+
+bool InitializeQuadVAO(Geometry *geometry)
+{
+	const vec2 corners[4] = { vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1) };
+
+	glGenBuffers(1, &geometry->vertexBuffer);
+	glGenBuffers(1, &geometry->instanceBuffer);
+	glGenVertexArrays(1, &geometry->vertexArray);
+	glBindVertexArray(geometry->vertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glVertexAttribPointer(CORNER_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+	glEnableVertexAttribArray(CORNER_INDEX);
+
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->instanceBuffer);
+	glVertexAttribPointer(PLANE_INDEX, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+	                      (void *)offsetof(GlyphQuad, plane));
+	glVertexAttribPointer(TEXELS_INDEX, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+	                      (void *)offsetof(GlyphQuad, texels));
+	glVertexAttribDivisor(PLANE_INDEX, 1);
+	glVertexAttribDivisor(TEXELS_INDEX, 1);
+	glEnableVertexAttribArray(PLANE_INDEX);
+	glEnableVertexAttribArray(TEXELS_INDEX);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	return !CheckGLErrors();
+}
+
+// fill the instance buffer with one quad per character
+bool LoadQuads(Geometry *geometry, const vector<GlyphQuad> &quads)
+{
+	geometry->elementCount = quads.size();
+
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GlyphQuad)*quads.size(), quads.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return !CheckGLErrors();
+}
+
+// fill the buffers with patches, each degree after the one before
+bool LoadPatches(Geometry *geometry, const PatchLists &patches)
+{
+	vector<vec2> points;
+	vector<vec3> colours;
+	for (int d = 0; d < 4; d++) {
+		geometry->batchFirst[d] = points.size();
+		geometry->batchCount[d] = patches.points[d].size();
+		points.insert(points.end(), patches.points[d].begin(), patches.points[d].end());
+		colours.insert(colours.end(), patches.colours[d].begin(), patches.colours[d].end());
+	}
+	return LoadGeometry(geometry, points.data(), colours.data(), points.size());
+}
+
+// size the instance buffer for every slot of a view, and fill the slots
+// whose lines changed in the last update of the view
+bool AllocateSlots(Geometry *geometry, const TextView &view)
+{
+	geometry->elementCount = 0;
+
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GlyphQuad)*view.SlotCount()*view.SlotCapacity(), 0,
+	             GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return !CheckGLErrors();
+}
+
+bool LoadSlots(Geometry *geometry, const TextView &view)
+{
+	const vector<int> &dirty = view.DirtySlots();
+	if (dirty.empty())
+		return true;
+
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->instanceBuffer);
+	for (size_t i = 0; i < dirty.size(); i++) {
+		const vector<GlyphQuad> &quads = view.SlotQuads(dirty[i]);
+		if (!quads.empty())
+			glBufferSubData(GL_ARRAY_BUFFER,
+			                sizeof(GlyphQuad)*dirty[i]*view.SlotCapacity(),
+			                sizeof(GlyphQuad)*quads.size(), quads.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return !CheckGLErrors();
+}
+
+// upload an atlas as a single channel texture with linear filtering, which
+// interpolates the distances between texels
+bool LoadAtlasTexture(MyTexture *texture, const GlyphAtlas &atlas)
+{
+	if (!texture->textureID)
+		glGenTextures(1, &texture->textureID);
+	texture->target = GL_TEXTURE_2D;
+	texture->width = atlas.Width();
+	texture->height = atlas.Height();
+
+	glBindTexture(GL_TEXTURE_2D, texture->textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas.Width(), atlas.Height(), 0, GL_RED,
+	             GL_UNSIGNED_BYTE, atlas.Pixels().data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return !CheckGLErrors();
+}
+
 // deallocate geometry-related objects
 void DestroyGeometry(Geometry *geometry)
 {
@@ -186,12 +428,76 @@ void DestroyGeometry(Geometry *geometry)
 	glDeleteVertexArrays(1, &geometry->vertexArray);
 	glDeleteBuffers(1, &geometry->vertexBuffer);
 	glDeleteBuffers(1, &geometry->colourBuffer);
+	glDeleteBuffers(1, &geometry->instanceBuffer);
+}
+
+// a multisampled framebuffer the curves are drawn into when they are not
+// anti-aliased analytically, resolved to the window after each frame
+struct MultisampleTarget
+{
+	GLuint framebuffer;
+	GLuint colourBuffer;
+	int width;
+	int height;
+
+	MultisampleTarget() : framebuffer(0), colourBuffer(0), width(0), height(0)
+	{}
+};
+
+void DestroyMultisampleTarget(MultisampleTarget *target)
+{
+	glDeleteFramebuffers(1, &target->framebuffer);
+	glDeleteRenderbuffers(1, &target->colourBuffer);
+	*target = MultisampleTarget();
+}
+
+// (re)creates the target if it is not width by height pixels
+bool ResizeMultisampleTarget(MultisampleTarget *target, int width, int height, int samples)
+{
+	if (target->framebuffer && target->width == width && target->height == height)
+		return true;
+	DestroyMultisampleTarget(target);
+
+	glGenRenderbuffers(1, &target->colourBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, target->colourBuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &target->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+	                          target->colourBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		cout << "ERROR: Multisampled framebuffer is incomplete" << endl;
+		DestroyMultisampleTarget(target);
+		return false;
+	}
+	target->width = width;
+	target->height = height;
+	return !CheckGLErrors();
+}
+
+// averages the samples of the target into the window
+void ResolveMultisampleTarget(const MultisampleTarget &target)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, target.width, target.height, 0, 0, target.width, target.height,
+	                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 // --------------------------------------------------------------------------
 // Rendering function that draws our scene to the frame buffer
 
-void RenderScene(Geometry *geometry, GLuint program1, GLuint program2)
+// draws the patches of geometry, or the runs of line from the shared glyph
+// patches in text when line is given, counting the line segments produced
+// in query, if non-zero
+void RenderScene(Geometry *geometry, Geometry *text, const TextLine *line, GLuint programs[4],
+                 GLuint program2, vec2 offset, vec2 viewport, GLuint query)
 {
 	// clear screen to a dark grey colour
 	glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
@@ -208,11 +514,63 @@ void RenderScene(Geometry *geometry, GLuint program1, GLuint program2)
             glDrawArrays(GL_LINE_STRIP, 0, geometry->elementCount);
         }
 
-        glUseProgram(program1);
-        GLint degreeLoc = glGetUniformLocation(program1, "degree");
-        glPatchParameteri(GL_PATCH_VERTICES, degree);
-        glUniform1i(degreeLoc, degree);
-        glDrawArrays(GL_PATCHES, 0, geometry->elementCount);
+        // each degree of segment is drawn by its own program: lines as
+        // GL_LINES, then curves as patches of 3 or 4 control points, of
+        // which only the curves are counted by the query. Analytic coverage
+        // is blended over what is already there.
+        if (analyticAA) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        Geometry *source = line ? text : geometry;
+        glBindVertexArray(source->vertexArray);
+        if (line)
+            glBindBuffer(GL_ARRAY_BUFFER, text->instanceBuffer);
+
+        for (int d = 1; d <= 3; d++) {
+            if (query && d == 2)
+                glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+            if (source->batchCount[d] == 0)
+                continue;
+
+            glUseProgram(programs[d]);
+            GLint offsetLoc = glGetUniformLocation(programs[d], "offset");
+            glUniform2f(offsetLoc, offset.x, offset.y);
+            GLint scaleLoc = glGetUniformLocation(programs[d], "scale");
+            glUniform1f(scaleLoc, line ? line->size : 1.0f);
+            GLint viewportLoc = glGetUniformLocation(programs[d], "viewport");
+            glUniform2f(viewportLoc, viewport.x, viewport.y);
+            GLint strokeWidthLoc = glGetUniformLocation(programs[d], "strokeWidth");
+            glUniform1f(strokeWidthLoc, STROKE_WIDTH);
+
+            GLenum mode = GL_LINES;
+            if (d > 1) {
+                mode = GL_PATCHES;
+                glPatchParameteri(GL_PATCH_VERTICES, d + 1);
+                GLint toleranceLoc = glGetUniformLocation(programs[d], "tolerance");
+                glUniform1f(toleranceLoc, adaptiveTess ? tessTolerance : 0.0f);
+            }
+
+            if (line) {
+                // one instanced draw per glyph; without base instance (GL 4.2)
+                // each run picks its pen positions by moving the attribute
+                for (size_t i = 0; i < line->runs.size(); i++) {
+                    const GlyphRun &run = line->runs[i];
+                    if (run.count[d] == 0)
+                        continue;
+                    glVertexAttribPointer(INSTANCE_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2),
+                                          (void *)(run.firstInstance * sizeof(vec2)));
+                    glDrawArraysInstanced(mode, source->batchFirst[d] + run.first[d],
+                                          run.count[d], run.instanceCount);
+                }
+            } else {
+                glDrawArrays(mode, source->batchFirst[d], source->batchCount[d]);
+            }
+        }
+        if (query)
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDisable(GL_BLEND);
 
 	// reset state to default (no shader or geometry bound)
 	glBindVertexArray(0);
@@ -222,6 +580,50 @@ void RenderScene(Geometry *geometry, GLuint program1, GLuint program2)
 	CheckGLErrors();
 }
 
+// draws one textured quad per character from the atlas in texture; with a
+// view, only the quads of its visible slots are drawn
+void RenderAtlasText(Geometry *quads, MyTexture *texture, GLuint program, vec2 offset,
+                     const TextView *view = 0)
+{
+	glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(program);
+	glUniform2f(glGetUniformLocation(program, "offset"), offset.x, offset.y);
+	glUniform3f(glGetUniformLocation(program, "colour"), 1.0f, 1.0f, 1.0f);
+	glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture->textureID);
+	glBindVertexArray(quads->vertexArray);
+	if (view) {
+		// each slot is drawn from its own place in the instance buffer
+		const vector<ViewSlot> &visible = view->VisibleSlots();
+		glBindBuffer(GL_ARRAY_BUFFER, quads->instanceBuffer);
+		for (size_t i = 0; i < visible.size(); i++) {
+			size_t first = size_t(visible[i].slot) * view->SlotCapacity();
+			glVertexAttribPointer(PLANE_INDEX, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+			                      (void *)(first*sizeof(GlyphQuad) + offsetof(GlyphQuad, plane)));
+			glVertexAttribPointer(TEXELS_INDEX, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphQuad),
+			                      (void *)(first*sizeof(GlyphQuad) + offsetof(GlyphQuad, texels)));
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, visible[i].count);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	} else {
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, quads->elementCount);
+	}
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	glDisable(GL_BLEND);
+
+	CheckGLErrors();
+}
+
 // --------------------------------------------------------------------------
 // GLFW callback functions
 
@@ -254,7 +656,7 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
                     font++;
             }
 
-            if (scene == 3) {
+            if (scene >= 3) {
                 if (scrollFont == 3)
                     scrollFont = 1;
                 else
@@ -277,7 +679,7 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
                     font--;
             }
 
-            if (scene == 3) {
+            if (scene >= 3) {
                 if (scrollFont == 1)
                     scrollFont = 3;
                 else
@@ -286,7 +688,7 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         }
 
         if (key == GLFW_KEY_RIGHT) {
-            if (scene == 3)
+            if (scene == 5)
                 scene = 1;
             else
                 scene++;
@@ -294,18 +696,30 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 
         if (key == GLFW_KEY_LEFT) {
             if (scene == 1)
-                scene = 3;
+                scene = 5;
             else
                 scene--;
         }
 
-        if (key == GLFW_KEY_D && scene == 3) {
+        if (key == GLFW_KEY_D && scene >= 3) {
             if (scrollSpeed > -0.01) {
                 scrollSpeed -= 0.002;
             }
         }
 
-        if (key == GLFW_KEY_F && scene == 3) {
+        if (key == GLFW_KEY_T)
+            adaptiveTess = !adaptiveTess;
+
+        if (key == GLFW_KEY_A)
+            analyticAA = !analyticAA;
+
+        if (key == GLFW_KEY_LEFT_BRACKET && tessTolerance > 0.02f)
+            tessTolerance /= 2.0f;
+
+        if (key == GLFW_KEY_RIGHT_BRACKET && tessTolerance < 16.0f)
+            tessTolerance *= 2.0f;
+
+        if (key == GLFW_KEY_F && scene >= 3) {
             if (scrollSpeed < 0.04) {
                 scrollSpeed += 0.005;
             }
@@ -317,9 +731,10 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 // --------------------------------------------------------------------------
 // Functions to aid generating the bezier curves
 
-void generateQuadratics(vector<vec2>* points, vector<vec3>* colours) {
-    points->clear();
-    colours->clear();
+void generateQuadratics(PatchLists* patches) {
+    patches->Clear();
+    vector<vec2>* points = &patches->points[2];
+    vector<vec3>* colours = &patches->colours[2];
 
     points->push_back(vec2(0.4f, 0.4f));
     points->push_back(vec2(0.8f, -0.4f));
@@ -344,9 +759,10 @@ void generateQuadratics(vector<vec2>* points, vector<vec3>* colours) {
     }
 }
 
-void generateCubics(vector<vec2>* points, vector<vec3>* colours) {
-    points->clear();
-    colours->clear();
+void generateCubics(PatchLists* patches) {
+    patches->Clear();
+    vector<vec2>* points = &patches->points[3];
+    vector<vec3>* colours = &patches->colours[3];
 
     points->push_back(vec2(0.1f * 2 - 0.9f, 0.1f * 2 - 0.6f));
     points->push_back(vec2(0.4f * 2 - 0.9f, 0.0f * 2 - 0.6f));
@@ -387,276 +803,166 @@ bool has_suffix(const string &str, const string &suffix) {
            str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
 
-float findMidpoint(float a, float b) {
-    return (a + b) / 2.0f;
-}
-
-void generateLetter(MyGlyph glyph, vector<vec2>* points,
-                    vector<vec3>* colours, float adv, float ratio) {
-    float xBegin,yBegin;
-    float xEnd, yEnd;
-    float xMid, yMid;
-
-    for (size_t i = 0; i < glyph.contours.size(); i++) {
-        for (size_t j = 0; j < glyph.contours.at(i).size(); j++) {
-            if (glyph.contours.at(i).at(j).degree == 1) {
-                xBegin = glyph.contours.at(i).at(j).x[0] * ratio;
-                yBegin = glyph.contours.at(i).at(j).y[0] * ratio;
-                xEnd = glyph.contours.at(i).at(j).x[1] * ratio;
-                yEnd = glyph.contours.at(i).at(j).y[1] * ratio;
-                xMid = findMidpoint(xBegin, xEnd);
-                yMid = findMidpoint(yBegin, yEnd);
-
-                points->push_back(vec2(xBegin - adv, yBegin - 0.2f));
-                points->push_back(vec2(xMid - adv, yMid - 0.2f));
-                if (degree == 4)
-                    points->push_back(vec2(xMid - adv, yMid - 0.2f));
-                points->push_back(vec2(xEnd - adv, yEnd - 0.2f));
-
-            } else {
-                for (int k = 0; k < degree; k++) {
-                    xBegin = glyph.contours.at(i).at(j).x[k] * ratio;
-                    yBegin = glyph.contours.at(i).at(j).y[k] * ratio;
-                    points->push_back(vec2(xBegin - adv, yBegin - 0.2f));
-                }
-            }
-
-            for (int k = 0; k < degree; k++)
-                colours->push_back(vec3(1.0f, 1.0f, 1.0f));
-        }
-    }
+void generateLetter(const GlyphOutline &glyph, PatchLists* patches, float adv, float ratio) {
+    AppendGlyphPatches(glyph, vec2(-adv, -0.2f), ratio, patches);
 }
 
-void generateNameLora(vector<vec2>* points, vector<vec3>* colours) {
-    points->clear();
-    colours->clear();
-
-    degree = 3;
+void generateNameLora(PatchLists* patches) {
+    patches->Clear();
 
-    GlyphExtractor ge;
-    if (!ge.LoadFontFile("fonts/Lora-Regular.ttf"))
+    int face = fontManager.LoadFont("fonts/Lora-Regular.ttf");
+    if (face < 0)
         return;
 
-    generateLetter(ge.ExtractGlyph('H'), points, colours, 1.0f, 0.7);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, 0.5f, 0.7);
-    generateLetter(ge.ExtractGlyph('n'), points, colours, 0.15f, 0.7);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -0.275f, 0.7);
-    generateLetter(ge.ExtractGlyph('y'), points, colours, -0.6f, 0.7);
+    generateLetter(fontManager.GetOutline(face, 'H'), patches, 1.0f, 0.7);
+    generateLetter(fontManager.GetOutline(face, 'e'), patches, 0.5f, 0.7);
+    generateLetter(fontManager.GetOutline(face, 'n'), patches, 0.15f, 0.7);
+    generateLetter(fontManager.GetOutline(face, 'r'), patches, -0.275f, 0.7);
+    generateLetter(fontManager.GetOutline(face, 'y'), patches, -0.6f, 0.7);
 }
-void generateNameSourceSans(vector<vec2>* points, vector<vec3>* colours) {
-    points->clear();
-    colours->clear();
+void generateNameSourceSans(PatchLists* patches) {
+    patches->Clear();
 
-    degree = 4;
-
-    GlyphExtractor ge;
-    if (!ge.LoadFontFile("fonts/SourceSansPro-Regular.otf"))
+    int face = fontManager.LoadFont("fonts/SourceSansPro-Regular.otf");
+    if (face < 0)
         return;
 
-    generateLetter(ge.ExtractGlyph('H'), points, colours, 1.0f, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, 0.5f, 0.85);
-    generateLetter(ge.ExtractGlyph('n'), points, colours, 0.125f, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -0.275f, 0.85);
-    generateLetter(ge.ExtractGlyph('y'), points, colours, -0.6f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'H'), patches, 1.0f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'e'), patches, 0.5f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'n'), patches, 0.125f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'r'), patches, -0.275f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'y'), patches, -0.6f, 0.85);
 }
-void generateNameInconsolata(vector<vec2>* points, vector<vec3>* colours) {
-    points->clear();
-    colours->clear();
-
-    degree = 4;
+void generateNameInconsolata(PatchLists* patches) {
+    patches->Clear();
 
-    GlyphExtractor ge;
-    if (!ge.LoadFontFile("fonts/Inconsolata.otf"))
+    int face = fontManager.LoadFont("fonts/Inconsolata.otf");
+    if (face < 0)
         return;
 
-    generateLetter(ge.ExtractGlyph('H'), points, colours, 1.0f, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, 0.6f, 0.85);
-    generateLetter(ge.ExtractGlyph('n'), points, colours, 0.2f, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -0.2f, 0.85);
-    generateLetter(ge.ExtractGlyph('y'), points, colours, -0.6f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'H'), patches, 1.0f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'e'), patches, 0.6f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'n'), patches, 0.2f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'r'), patches, -0.2f, 0.85);
+    generateLetter(fontManager.GetOutline(face, 'y'), patches, -0.6f, 0.85);
 }
 
-void generateSentenceInconsolata(vector<vec2>* points, vector<vec3>* colours, float time) {
-    points->clear();
-    colours->clear();
-
-    degree = 4;
-
-    GlyphExtractor ge;
-    if (!ge.LoadFontFile("fonts/Inconsolata.otf"))
-        return;
-
-    resetTime = 16.0f;
-
-    generateLetter(ge.ExtractGlyph('T'), points, colours, 1.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('h'), points, colours, 0.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, 0.2f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('q'), points, colours, -0.3 + time, 0.85);
-    generateLetter(ge.ExtractGlyph('u'), points, colours, -0.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('i'), points, colours, -1.1f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('c'), points, colours, -1.4f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('k'), points, colours, -1.8f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('b'), points, colours, -2.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -2.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -3.1f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('w'), points, colours, -3.5f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('n'), points, colours, -3.9f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('f'), points, colours, -4.4f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -4.8f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('x'), points, colours, -5.2f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('j'), points, colours, -5.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('u'), points, colours, -6.1f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('m'), points, colours, -6.5f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('p'), points, colours, -6.9f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -7.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('d'), points, colours, -7.7f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -8.2f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('v'), points, colours, -8.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -9.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -9.4f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('t'), points, colours, -9.9f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('h'), points, colours, -10.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -10.7f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('l'), points, colours, -11.2f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('a'), points, colours, -11.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('z'), points, colours, -12.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('y'), points, colours, -12.4f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('d'), points, colours, -12.9f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -13.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('g'), points, colours, -13.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('.'), points, colours, -14.0f + time, 0.85);
+// the scrolling sentence, laid out once per font with its pen starting at
+// the origin; it is moved along by the offset uniform of the outline
+// programs, and the scroll restarts once the end of the line has passed the
+// left edge. Returns 0 if the font could not be loaded
+const TextLine *generateSentence(const string &fontFile) {
+    int face = fontManager.LoadFont(fontFile);
+    if (face < 0)
+        return 0;
+
+    const TextLine &line = textLayout.Layout(sentence, face, 0.85f);
+    resetTime = line.width + 1.0f;
+    return &line;
 }
 
-void generateSentenceAlex(vector<vec2>* points, vector<vec3>* colours, float time) {
-    points->clear();
-    colours->clear();
-
-    degree = 3;
-
-    GlyphExtractor ge;
-    if (!ge.LoadFontFile("fonts/AlexBrush-Regular.ttf"))
-        return;
-
-    resetTime = 15.0f;
-
-    generateLetter(ge.ExtractGlyph('T'), points, colours, 1.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('h'), points, colours, 0.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, 0.2f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('q'), points, colours, -0.3 + time, 0.85);
-    generateLetter(ge.ExtractGlyph('u'), points, colours, -0.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('i'), points, colours, -1.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('c'), points, colours, -1.25f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('k'), points, colours, -1.6f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('b'), points, colours, -2.2f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -2.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -3.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('w'), points, colours, -3.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('n'), points, colours, -3.7f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('f'), points, colours, -4.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -4.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('x'), points, colours, -4.9f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('j'), points, colours, -5.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('u'), points, colours, -5.8f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('m'), points, colours, -6.25f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('p'), points, colours, -6.85f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -7.2f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('d'), points, colours, -7.5f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -8.1f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('v'), points, colours, -8.4f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -8.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -9.0f + time, 0.85);
+// the distance field atlas of a scrolling font, which is built (on every
+// core) or read from its cache the first time the font is shown. Returns the
+// atlas and sets face, or returns 0 if the font could not be loaded
+const GlyphAtlas *loadAtlas(const string &fontFile, int index, int *face) {
+    *face = fontManager.LoadFont(fontFile);
+    if (*face < 0)
+        return 0;
+
+    GlyphAtlas &atlas = atlases[index];
+    if (!atlasTextures[index].textureID) {
+        // printable ASCII, and anything else the sentence needs
+        vector<int> codes = DecodeUTF8(sentence);
+        for (int c = 32; c < 127; c++)
+            codes.push_back(c);
+
+        double ms = atlas.LoadOrBuild(fontManager, *face, codes, ATLAS_PIXELS_PER_EM, ATLAS_RANGE);
+        if (ms > 0.0)
+            cout << "Built distance field atlas for " << fontFile << " in " << ms << " ms" << endl;
+        else
+            cout << "Read distance field atlas for " << fontFile << " from "
+                 << AtlasPath(fontFile, ATLAS_PIXELS_PER_EM) << endl;
+        LoadAtlasTexture(&atlasTextures[index], atlas);
+    }
+    return &atlas;
+}
 
-    generateLetter(ge.ExtractGlyph('t'), points, colours, -9.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('h'), points, colours, -9.95f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -10.4f + time, 0.85);
+// the scrolling sentence as filled text, one quad per character from the
+// atlas of the font. Returns the atlas, or 0 if the font could not be loaded
+const GlyphAtlas *generateFilledSentence(const string &fontFile, int index,
+                                         vector<GlyphQuad> *quads) {
+    quads->clear();
 
-    generateLetter(ge.ExtractGlyph('l'), points, colours, -10.9f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('a'), points, colours, -11.2f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('z'), points, colours, -11.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('y'), points, colours, -12.0f + time, 0.85);
+    int face;
+    const GlyphAtlas *atlas = loadAtlas(fontFile, index, &face);
+    if (!atlas)
+        return 0;
 
-    generateLetter(ge.ExtractGlyph('d'), points, colours, -12.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -13.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('g'), points, colours, -13.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('.'), points, colours, -13.6f + time, 0.85);
+    resetTime = atlas->Layout(fontManager, face, sentence, 0.85f, quads) + 1.0f;
+    return atlas;
 }
 
-void generateSentenceLora(vector<vec2>* points, vector<vec3>* colours, float time) {
-    points->clear();
-    colours->clear();
+// the text of the document: the file given on the command line, or else a
+// thousand numbered paragraphs of the sentence, some 120k characters
+const string &documentSource() {
+    if (!documentText.empty())
+        return documentText;
+
+    if (!documentFile.empty()) {
+        ifstream input(documentFile.c_str());
+        if (input) {
+            documentText.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+            if (!documentText.empty())
+                return documentText;
+        }
+        cout << "ERROR: Could not read document " << documentFile
+             << ", showing the generated one" << endl;
+    }
 
-    degree = 3;
+    for (int i = 1; i <= 1000; i++) {
+        documentText += to_string(i) + ".";
+        for (int j = 0; j <= i % 4; j++)
+            documentText += " " + sentence;
+        documentText += "\n";
+    }
+    return documentText;
+}
 
-    GlyphExtractor ge;
-    if (!ge.LoadFontFile("fonts/Lora-Regular.ttf"))
-        return;
+// a view of the document in a scrolling font, wrapped to the width of the
+// window. Nothing is laid out yet; lines are wrapped as the view first
+// scrolls to them. Returns 0 if the font could not be loaded
+TextView *generateDocument(const string &fontFile, int index) {
+    delete documentView;
+    documentView = 0;
+
+    int face;
+    const GlyphAtlas *atlas = loadAtlas(fontFile, index, &face);
+    if (!atlas)
+        return 0;
+
+    documentView = new TextView(fontManager, *atlas, face, DOCUMENT_SIZE, 1.9f,
+                                DOCUMENT_LINE_HEIGHT, DOCUMENT_SLOTS, DOCUMENT_SLOT_CAPACITY);
+    documentView->SetText(documentSource());
+    return documentView;
+}
 
-    resetTime = 18;
-
-    generateLetter(ge.ExtractGlyph('T'), points, colours, 1.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('h'), points, colours, 0.45f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, 0.0f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('q'), points, colours, -0.6 + time, 0.85);
-    generateLetter(ge.ExtractGlyph('u'), points, colours, -1.1f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('i'), points, colours, -1.6f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('c'), points, colours, -1.8f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('k'), points, colours, -2.2f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('b'), points, colours, -2.8f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -3.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -3.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('w'), points, colours, -4.2f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('n'), points, colours, -4.9f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('f'), points, colours, -5.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -6.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('x'), points, colours, -6.5f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('j'), points, colours, -7.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('u'), points, colours, -7.5f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('m'), points, colours, -8.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('p'), points, colours, -8.7f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -9.2f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('d'), points, colours, -9.65f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -10.4f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('v'), points, colours, -10.9f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -11.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('r'), points, colours, -11.7f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('t'), points, colours, -12.4f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('h'), points, colours, -12.8f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('e'), points, colours, -13.3f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('l'), points, colours, -14.0f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('a'), points, colours, -14.3f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('z'), points, colours, -14.8f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('y'), points, colours, -15.25f + time, 0.85);
-
-    generateLetter(ge.ExtractGlyph('d'), points, colours, -15.9f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('o'), points, colours, -16.35f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('g'), points, colours, -16.8f + time, 0.85);
-    generateLetter(ge.ExtractGlyph('.'), points, colours, -17.2f + time, 0.85);
+// how many segments of each degree an outline scene draws, and how many
+// vertices its lines take as GL_LINES rather than raised to curves and
+// tessellated into 64 segments each
+void reportBatches(size_t lines, size_t quadratics, size_t cubics) {
+    cout << "Outline batches: " << lines << " lines, " << quadratics << " quadratics, "
+         << cubics << " cubics; the lines are " << 2 * lines << " vertices as GL_LINES, "
+         << 65 * lines << " as 64 segment patches" << endl;
 }
+
 // ==========================================================================
 // PROGRAM ENTRY POINT
 
 int main(int argc, char *argv[])
 {
+	if (argc > 1)
+		documentFile = argv[1];
+
 	// initialize the GLFW windowing system
 	if (!glfwInit()) {
 		cout << "ERROR: GLFW failed to initialize, TERMINATING" << endl;
@@ -670,7 +976,6 @@ int main(int argc, char *argv[])
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_SAMPLES, 4);
 	int width = 512, height = 512;
 	window = glfwCreateWindow(width, height, "CPSC 453 Assignment 3", 0, 0);
 	if (!window) {
@@ -694,17 +999,19 @@ int main(int argc, char *argv[])
 	QueryGLVersion();
 
 	// call function to load and compile shader programs
-        GLuint program1;
-        GLuint program2;
+        GLuint programs[4] = { 0, 0, 0, 0 };
+        GLuint strokePrograms[4] = { 0, 0, 0, 0 };
+        GLuint program2 = 0;
 
-        vector<vec2> points;
-        vector<vec3> colours;
+        PatchLists patches;
 
         float timeElapsed = 0.0f;
 
-        InitializeShaders(&program1, &program2);
+        InitializeShaders(programs, strokePrograms, &program2);
+        GLuint atlasProgram = InitializeAtlasShader();
 
-	if (program1 == 0 || program2 == 0) {
+	if (programs[1] == 0 || programs[2] == 0 || programs[3] == 0 || strokePrograms[1] == 0 ||
+	    strokePrograms[2] == 0 || strokePrograms[3] == 0 || program2 == 0 || atlasProgram == 0) {
 		cout << "Program could not initialize shaders, TERMINATING" << endl;
 		return -1;
 	}
@@ -714,44 +1021,234 @@ int main(int argc, char *argv[])
 	if (!InitializeVAO(&geometry))
 		cout << "Program failed to intialize geometry!" << endl;
 
-	if(!LoadGeometry(&geometry, points.data(), colours.data(), points.size()))
+	if(!LoadPatches(&geometry, patches))
 		cout << "Failed to load geometry" << endl;
 
+	// the glyph patches shared by all text, drawn as one instance per
+	// character; uploaded again only when a line adds new glyphs
+	Geometry textGeometry;
+	if (!InitializeVAO(&textGeometry, true))
+		cout << "Program failed to intialize text geometry!" << endl;
+	const TextLine *line = 0;
+
+	// filled text from a distance field atlas, one quad per character
+	Geometry quadGeometry;
+	if (!InitializeQuadVAO(&quadGeometry))
+		cout << "Program failed to intialize quad geometry!" << endl;
+	vector<GlyphQuad> quads;
+	const GlyphAtlas *atlas = 0;
+
+	// the document of scene 5, of which only the lines in view have quads
+	Geometry documentGeometry;
+	if (!InitializeQuadVAO(&documentGeometry))
+		cout << "Program failed to intialize document geometry!" << endl;
+	TextView *view = 0;
+	float documentScroll = 0.0f;
+
+        // geometry is only rebuilt and uploaded when the scene, degree or
+        // font shown changes; scrolling just moves it with a uniform
+        int loadedScene = 0;
+        int loadedVariant = 0;
+
+        // two queries used in turn, so each frame reads the segment count of
+        // the one before without waiting on the GPU
+        GLuint segmentQueries[2];
+        GLuint queryPatches[2];
+        float queryTolerance[2];
+        bool queryStroked[2];
+        bool queried[2] = { false, false };
+        glGenQueries(2, segmentQueries);
+
+        // GPU time spent drawing curves, read the same way and reported as
+        // an average every TIMING_FRAMES frames for each way of smoothing
+        // them
+        const int TIMING_FRAMES = 120;
+        GLuint timeQueries[2];
+        bool timed[2] = { false, false };
+        bool timedAnalytic[2];
+        glGenQueries(2, timeQueries);
+        double timeTotal = 0.0;
+        int timeFrames = 0;
+        MultisampleTarget multisampled;
+        int frame = 0;
+        GLuint lastSegments = 0;
+        float lastTolerance = -1.0f;
+
 	// run an event-triggered main loop
 	while (!glfwWindowShouldClose(window))
 	{
-            if (scene == 1) {
-                if (degree == 3)
-                    generateQuadratics(&points, &colours);
-                else
-                    generateCubics(&points, &colours);
-            } else if (scene == 2) {
-                if (font == 1)
-                    generateNameLora(&points, &colours);
-                if (font == 2)
-                    generateNameSourceSans(&points, &colours);
-                if (font == 3)
-                    generateNameInconsolata(&points, &colours);
-            } else {
-                timeElapsed += 0.02f + scrollSpeed;
+            int variant = scene == 1 ? degree : scene == 2 ? font : scrollFont;
+            bool changed = scene != loadedScene || variant != loadedVariant;
+            vec2 offset(0.0f, 0.0f);
+
+            if (changed) {
+                if (scene == 1) {
+                    if (degree == 3)
+                        generateQuadratics(&patches);
+                    else
+                        generateCubics(&patches);
+                } else if (scene == 2) {
+                    if (font == 1)
+                        generateNameLora(&patches);
+                    if (font == 2)
+                        generateNameSourceSans(&patches);
+                    if (font == 3)
+                        generateNameInconsolata(&patches);
+                } else if (scene == 5) {
+                    if (scrollFont == 1)
+                        view = generateDocument("fonts/Inconsolata.otf", 0);
+                    if (scrollFont == 2)
+                        view = generateDocument("fonts/AlexBrush-Regular.ttf", 1);
+                    if (scrollFont == 3)
+                        view = generateDocument("fonts/Lora-Regular.ttf", 2);
+                    documentScroll = 0.0f;
+                } else if (scene == 4) {
+                    if (scrollFont == 1)
+                        atlas = generateFilledSentence("fonts/Inconsolata.otf", 0, &quads);
+                    if (scrollFont == 2)
+                        atlas = generateFilledSentence("fonts/AlexBrush-Regular.ttf", 1, &quads);
+                    if (scrollFont == 3)
+                        atlas = generateFilledSentence("fonts/Lora-Regular.ttf", 2, &quads);
+                } else {
+                    if (scrollFont == 1)
+                        line = generateSentence("fonts/Inconsolata.otf");
+                    if (scrollFont == 2)
+                        line = generateSentence("fonts/AlexBrush-Regular.ttf");
+                    if (scrollFont == 3)
+                        line = generateSentence("fonts/Lora-Regular.ttf");
+                }
 
-                if (scrollFont == 1)
-                    generateSentenceInconsolata(&points, &colours, timeElapsed);
-                if (scrollFont == 2)
-                    generateSentenceAlex(&points, &colours, timeElapsed);
-                if (scrollFont == 3)
-                    generateSentenceLora(&points, &colours, timeElapsed);
+                if (scene == 5) {
+                    if (view)
+                        AllocateSlots(&documentGeometry, *view);
+                } else if (scene == 4) {
+                    LoadQuads(&quadGeometry, quads);
+                } else if (scene != 3) {
+                    line = 0;
+                    LoadPatches(&geometry, patches);
+                    reportBatches(patches.SegmentCount(1), patches.SegmentCount(2),
+                                  patches.SegmentCount(3));
+                } else if (line) {
+                    const PatchLists &shared = textLayout.Patches();
+                    size_t total = 0;
+                    for (int d = 0; d < 4; d++)
+                        total += shared.points[d].size();
+                    if (GLsizei(total) != textGeometry.elementCount)
+                        LoadPatches(&textGeometry, shared);
+                    LoadInstances(&textGeometry, line->pens);
+                    reportBatches(line->SegmentCount(1), line->SegmentCount(2),
+                                  line->SegmentCount(3));
+                } else {
+                    patches.Clear();
+                    LoadPatches(&geometry, patches);
+                }
+                loadedScene = scene;
+                loadedVariant = variant;
+            }
 
+            if (scene == 5 && view) {
+                // the document scrolls up, and starts over once its last
+                // line has left the top of the window
+                documentScroll += 0.005f + scrollSpeed / 4.0f;
+                if (documentScroll < 0.0f)
+                    documentScroll = 0.0f;
+                if (view->FullyWrapped() &&
+                    documentScroll > view->LinesWrapped() * view->LineHeight())
+                    documentScroll = 0.0f;
+                view->Update(documentScroll, 2.0f, DOCUMENT_MARGIN);
+                LoadSlots(&documentGeometry, *view);
+                offset = vec2(-0.95f, 1.0f + documentScroll);
+            } else if (scene >= 3) {
+                timeElapsed += 0.02f + scrollSpeed;
                 if (timeElapsed > resetTime)
                     timeElapsed = 0.0f;
-
+                offset = vec2(-1.0f - timeElapsed, -0.2f);
             }
 
-
-            LoadGeometry(&geometry, points.data(), colours.data(), points.size());
+            int fbWidth, fbHeight;
+            glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
 
 	    // call function to draw our scene
-            RenderScene(&geometry, program1, program2);
+            int current = frame % 2;
+            if (scene == 5) {
+                queried[current] = false;
+                timed[current] = false;
+                if (view)
+                    RenderAtlasText(&documentGeometry, &atlasTextures[scrollFont - 1],
+                                    atlasProgram, offset, view);
+            } else if (scene == 4) {
+                queried[current] = false;
+                timed[current] = false;
+                if (atlas)
+                    RenderAtlasText(&quadGeometry, &atlasTextures[scrollFont - 1], atlasProgram,
+                                    offset);
+            } else {
+                queried[current] = true;
+                queryPatches[current] = line ? line->SegmentCount(2) + line->SegmentCount(3)
+                                             : geometry.batchCount[2] / 3 + geometry.batchCount[3] / 4;
+                queryTolerance[current] = adaptiveTess ? tessTolerance : 0.0f;
+                queryStroked[current] = analyticAA;
+
+                timed[current] = true;
+                timedAnalytic[current] = analyticAA;
+                glBeginQuery(GL_TIME_ELAPSED, timeQueries[current]);
+                if (analyticAA) {
+                    RenderScene(&geometry, &textGeometry, line, strokePrograms, program2, offset,
+                                vec2(fbWidth, fbHeight), segmentQueries[current]);
+                } else if (ResizeMultisampleTarget(&multisampled, fbWidth, fbHeight, MSAA_SAMPLES)) {
+                    glBindFramebuffer(GL_FRAMEBUFFER, multisampled.framebuffer);
+                    RenderScene(&geometry, &textGeometry, line, programs, program2, offset,
+                                vec2(fbWidth, fbHeight), segmentQueries[current]);
+                    ResolveMultisampleTarget(multisampled);
+                }
+                glEndQuery(GL_TIME_ELAPSED);
+            }
+
+            // report the average time of the last TIMING_FRAMES frames
+            // drawn the same way
+            if (frame > 0 && timed[1 - current]) {
+                int previous = 1 - current;
+                if (timeFrames > 0 && timedAnalytic[previous] != timedAnalytic[current]) {
+                    timeTotal = 0.0;
+                    timeFrames = 0;
+                }
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(timeQueries[previous], GL_QUERY_RESULT, &nanoseconds);
+                timeTotal += nanoseconds * 1e-6;
+                if (++timeFrames == TIMING_FRAMES) {
+                    cout << "Curves with " << (timedAnalytic[previous] ? "analytic coverage"
+                                                                      : "4x MSAA")
+                         << ": " << timeTotal / timeFrames << " ms per frame" << endl;
+                    timeTotal = 0.0;
+                    timeFrames = 0;
+                }
+            }
+
+            // report the tessellation output whenever it changes; isolines
+            // evaluate one more vertex per patch than they have segments
+            if (frame > 0 && queried[1 - current]) {
+                int previous = 1 - current;
+                GLuint segments = 0;
+                glGetQueryObjectuiv(segmentQueries[previous], GL_QUERY_RESULT, &segments);
+
+                // analytic coverage draws each segment as two triangles
+                if (queryStroked[previous])
+                    segments /= 2;
+                GLuint patches = queryPatches[previous];
+                float tolerance = queryTolerance[previous];
+                if (segments != lastSegments || tolerance != lastTolerance) {
+                    cout << "Tessellation (";
+                    if (tolerance > 0.0f)
+                        cout << tolerance << " px tolerance";
+                    else
+                        cout << "fixed 64 segments";
+                    cout << "): " << patches << " patches, " << segments << " segments, "
+                         << segments + patches << " vertices per frame" << endl;
+                    lastSegments = segments;
+                    lastTolerance = tolerance;
+                }
+            }
+            frame++;
 
 	    glfwSwapBuffers(window);
 
@@ -759,10 +1256,26 @@ int main(int argc, char *argv[])
 	}
 
 	// clean up allocated resources before exit
+	glDeleteQueries(2, segmentQueries);
+	glDeleteQueries(2, timeQueries);
+	DestroyMultisampleTarget(&multisampled);
+	fontManager.PrintStats();
 	DestroyGeometry(&geometry);
+	DestroyGeometry(&textGeometry);
+	DestroyGeometry(&quadGeometry);
+	DestroyGeometry(&documentGeometry);
+	delete documentView;
+	for (int i = 0; i < 3; i++) {
+		if (atlasTextures[i].textureID)
+			DestroyTexture(&atlasTextures[i]);
+	}
 	glUseProgram(0);
-	glDeleteProgram(program1);
+	for (int d = 1; d <= 3; d++) {
+		glDeleteProgram(programs[d]);
+		glDeleteProgram(strokePrograms[d]);
+	}
         glDeleteProgram(program2);
+        glDeleteProgram(atlasProgram);
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
@@ -865,7 +1378,8 @@ GLuint CompileShader(GLenum shaderType, const string &source)
 }
 
 // creates and returns a program object linked from vertex and fragment shaders
-GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader)
+GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader,
+                   GLuint geometryShader)
 {
 	// allocate program object name
 	GLuint programObject = glCreateProgram();
@@ -875,6 +1389,7 @@ GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader,
 	if (fragmentShader) glAttachShader(programObject, fragmentShader);
 	if (tcsShader) glAttachShader(programObject, tcsShader);
 	if (tesShader) glAttachShader(programObject, tesShader);
+	if (geometryShader) glAttachShader(programObject, geometryShader);
 
 	// try linking the program with given attachments
 	glLinkProgram(programObject);
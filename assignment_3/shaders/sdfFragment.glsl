@@ -0,0 +1,24 @@
+// ==========================================================================
+// Fragment program for text drawn from a signed distance field atlas
+//
+// The atlas stores the distance to the outline with 0.5 on it and larger
+// values inside, so coverage is a threshold at 0.5, smoothed over about one
+// screen pixel for anti-aliasing at any size.
+// ==========================================================================
+#version 410
+
+in vec2 TexelPosition;
+
+out vec4 FragmentColour;
+
+uniform sampler2D atlas;
+uniform vec3 colour;
+
+void main(void)
+{
+    float distance = texture(atlas, TexelPosition / vec2(textureSize(atlas, 0))).r;
+    float width = max(fwidth(distance), 1e-4) * 0.7;
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+
+    FragmentColour = vec4(colour, alpha);
+}
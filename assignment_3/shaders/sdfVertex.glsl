@@ -0,0 +1,27 @@
+// ==========================================================================
+// Vertex program for text drawn from a signed distance field atlas
+//
+// Each character is one instance of a unit square, stretched over its quad
+// and mapped onto its texels in the atlas.
+// ==========================================================================
+#version 410
+
+// corner of the unit square, per vertex
+layout(location = 0) in vec2 Corner;
+
+// quad of the character (left, bottom, right, top) and its texels in the
+// atlas (x, y, width, height), per instance
+layout(location = 1) in vec4 Plane;
+layout(location = 2) in vec4 Texels;
+
+// translation applied to every quad, used to scroll text
+uniform vec2 offset;
+
+// position in the atlas, in texels
+out vec2 TexelPosition;
+
+void main()
+{
+    gl_Position = vec4(mix(Plane.xy, Plane.zw, Corner) + offset, 0.0, 1.0);
+    TexelPosition = Texels.xy + Corner * Texels.zw;
+}
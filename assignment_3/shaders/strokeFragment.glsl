@@ -0,0 +1,31 @@
+// ==========================================================================
+// Fragment program for curves drawn with analytic coverage
+//
+// Coverage of a pixel by a stroke strokeWidth pixels wide, from the distance
+// of the pixel centre to the segment: full within the stroke, falling off
+// linearly over one pixel at its edge, which approximates the area of the
+// pixel the stroke covers. Drawn with blending into a single sample
+// framebuffer.
+// ==========================================================================
+#version 410
+
+in vec3 StrokeColour;
+flat in vec4 Segment;
+
+out vec4 FragmentColour;
+
+uniform float strokeWidth;
+
+void main(void)
+{
+    vec2 a = Segment.xy;
+    vec2 b = Segment.zw;
+    vec2 p = gl_FragCoord.xy;
+
+    vec2 ab = b - a;
+    float t = clamp(dot(p - a, ab) / max(dot(ab, ab), 1e-8), 0.0, 1.0);
+    float d = length(p - a - t * ab);
+
+    float coverage = clamp(0.5 * strokeWidth + 0.5 - d, 0.0, 1.0);
+    FragmentColour = vec4(StrokeColour, coverage);
+}
@@ -0,0 +1,53 @@
+// ==========================================================================
+// Geometry program for curves drawn with analytic coverage
+//
+// Turns each line segment of a tessellated curve (or each straight outline
+// segment) into a quad covering every pixel within reach of it: half the
+// stroke width and one pixel more for the coverage to fall off over. The
+// fragment stage then measures each pixel's distance to the segment, which
+// anti-aliases the curve without multisampling.
+// ==========================================================================
+#version 410
+
+layout(lines) in;
+layout(triangle_strip, max_vertices = 4) out;
+
+// from the tessellation evaluation stage, or the vertex stage for lines
+in vec3 Colour[];
+
+out vec3 StrokeColour;
+
+// ends of the segment in window pixels, the same for the whole quad
+flat out vec4 Segment;
+
+// size of the framebuffer in pixels, and the width of the stroke
+uniform vec2 viewport;
+uniform float strokeWidth;
+
+void emit(vec2 pixel, vec4 segment, vec3 colour)
+{
+    gl_Position = vec4(pixel / viewport * 2.0 - 1.0, 0.0, 1.0);
+    Segment = segment;
+    StrokeColour = colour;
+    EmitVertex();
+}
+
+void main()
+{
+    vec2 a = (gl_in[0].gl_Position.xy * 0.5 + 0.5) * viewport;
+    vec2 b = (gl_in[1].gl_Position.xy * 0.5 + 0.5) * viewport;
+
+    vec2 along = b - a;
+    float len = length(along);
+    along = len > 1e-4 ? along / len : vec2(1.0, 0.0);
+    float reach = 0.5 * strokeWidth + 1.0;
+    vec2 u = along * reach;
+    vec2 v = vec2(-along.y, along.x) * reach;
+
+    vec4 segment = vec4(a, b);
+    emit(a - u - v, segment, Colour[0]);
+    emit(a - u + v, segment, Colour[0]);
+    emit(b + u - v, segment, Colour[1]);
+    emit(b + u + v, segment, Colour[1]);
+    EndPrimitive();
+}
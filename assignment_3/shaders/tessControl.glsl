@@ -1,36 +1,71 @@
-#version 410
-/**
-*Tessellation Control Shader
-*	Determines level of subdivision for the generated patch
-*	as well as determining which information is passed on
-*	to the next shader stage
-*	Run once for every vertex in input patch
-*/
-
-//This variable must match the patch size set in c++ program with
-//glPatchParameteri(GL_PATCH_VERTICES_VERTICES, n)
-layout(vertices=4) out;
-
-//Number of elements equal to patch size
-in vec3 tcColour[];	//From vertex shader
-out vec3 teColour[];	//To fragment shader
-
-//Variables which are implicitly included in every tess control shader
-//Struct containing gl_Position, gl_PointSize, and something else you'll probably never use
-//in gl_in[];
-//Structs containing the same information which can be written to to send to Tess Eval shader
-//out gl_out[];
-
-void main()
-{
-	//gl_InvocationID says which vertex in the patch you are processing
-	if(gl_InvocationID == 0)
-	{
-		gl_TessLevelOuter[0] = 1;	//Determines number of lines
-		gl_TessLevelOuter[1] = 64;	//Determines number of segments in line
-	}
-
-	//Passing information along to tessEval.glsl
-	gl_out[gl_InvocationID].gl_Position = gl_in[gl_InvocationID].gl_Position;
-	teColour[gl_InvocationID] = tcColour[gl_InvocationID];
-}
+#version 410
+/**
+*Tessellation Control Shader
+*	Determines level of subdivision for the generated patch
+*	as well as determining which information is passed on
+*	to the next shader stage
+*	Run once for every vertex in input patch
+*/
+
+//This variable must match the patch size set in c++ program with
+//glPatchParameteri(GL_PATCH_VERTICES_VERTICES, n). DEGREE is defined by the
+//program before compiling, 2 for quadratics and 3 for cubics.
+#if DEGREE == 2
+layout(vertices=3) out;
+#else
+layout(vertices=4) out;
+#endif
+
+//Number of elements equal to patch size
+in vec3 tcColour[];	//From vertex shader
+out vec3 teColour[];	//To fragment shader
+
+//Variables which are implicitly included in every tess control shader
+//Struct containing gl_Position, gl_PointSize, and something else you'll probably never use
+//in gl_in[];
+//Structs containing the same information which can be written to to send to Tess Eval shader
+//out gl_out[];
+
+//Size of the framebuffer in pixels, and the largest distance in pixels the
+//line segments may stray from the true curve. A tolerance of 0 or less
+//turns adaptive tessellation off and uses MAX_SEGMENTS for every patch.
+uniform vec2 viewport;
+uniform float tolerance;
+
+#define MAX_SEGMENTS 64.0
+
+//Number of segments needed to keep a Bezier curve of degree n within the
+//tolerance when it is sampled at evenly spaced parameters. The error is at
+//most n(n-1)/8 * M / N^2, where M is the longest second difference of the
+//control points, so nearly straight or tiny curves come out as a single
+//segment.
+float segments()
+{
+	vec2 scale = 0.5 * viewport;
+	vec2 p0 = gl_in[0].gl_Position.xy * scale;
+	vec2 p1 = gl_in[1].gl_Position.xy * scale;
+	vec2 p2 = gl_in[2].gl_Position.xy * scale;
+
+	float n = float(DEGREE);
+	float m = length(p0 - 2.0 * p1 + p2);
+#if DEGREE == 3
+	vec2 p3 = gl_in[3].gl_Position.xy * scale;
+	m = max(m, length(p1 - 2.0 * p2 + p3));
+#endif
+
+	return clamp(ceil(sqrt(n * (n - 1.0) * m / (8.0 * tolerance))), 1.0, MAX_SEGMENTS);
+}
+
+void main()
+{
+	//gl_InvocationID says which vertex in the patch you are processing
+	if(gl_InvocationID == 0)
+	{
+		gl_TessLevelOuter[0] = 1;	//Determines number of lines
+		gl_TessLevelOuter[1] = tolerance > 0.0 ? segments() : MAX_SEGMENTS;	//Determines number of segments in line
+	}
+
+	//Passing information along to tessEval.glsl
+	gl_out[gl_InvocationID].gl_Position = gl_in[gl_InvocationID].gl_Position;
+	teColour[gl_InvocationID] = tcColour[gl_InvocationID];
+}
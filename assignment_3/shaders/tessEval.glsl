@@ -16,8 +16,6 @@ in vec3 teColour[];
 //Will be interpolated as if sent from vertex shader
 out vec3 Colour;
 
-uniform int degree;
-
 #define PI 3.14159265359
 
 void main()
@@ -32,14 +30,16 @@ void main()
 	vec2 p0 = gl_in[0].gl_Position.xy;
 	vec2 p1 = gl_in[1].gl_Position.xy;
         vec2 p2 = gl_in[2].gl_Position.xy;
-        vec2 p3 = gl_in[3].gl_Position.xy;
 
-	//Equations for bezier bernstein form
-        if (degree == 3)
-            position = pow(b1, 2) * p0 + 2 * b0 * b1 * p1 + pow(b0, 2) * p2;
-        else
-            position = pow(b1, 3) * p0 + 3 * b0 * pow(b1, 2) * p1 +
-                       3 * pow(b0, 2) * b1 * p2 + pow(b0, 3) * p3;
+	//Equations for bezier bernstein form; DEGREE is defined by the program
+	//before compiling, and matches the patch size
+#if DEGREE == 2
+        position = pow(b1, 2) * p0 + 2 * b0 * b1 * p1 + pow(b0, 2) * p2;
+#else
+        vec2 p3 = gl_in[3].gl_Position.xy;
+        position = pow(b1, 3) * p0 + 3 * b0 * pow(b1, 2) * p1 +
+                   3 * pow(b0, 2) * b1 * p2 + pow(b0, 3) * p3;
+#endif
 
         gl_Position = vec4(position, 0, 1);
 
@@ -11,13 +11,32 @@
 layout(location = 0) in vec2 VertexPosition;
 layout(location = 1) in vec3 VertexColour;
 
-// output to be interpolated between vertices and passed to the fragment stage
+// pen position of the character being drawn, one per instance when text is
+// drawn from the shared glyph patches; (0, 0) for other geometry
+layout(location = 2) in vec2 InstancePosition;
+
+// DEGREE is defined by the program before compiling: 1 for straight lines,
+// which go directly to the fragment stage, and 2 or 3 for Bezier curves,
+// which go through the tessellation stages first
+#if DEGREE == 1
+#define tcColour Colour
+#endif
+
+// output to be interpolated between vertices and passed to the next stage
 out vec3 tcColour;
 
+// translation applied to every control point, used to scroll text without
+// uploading it again; Bezier curves move with their control points, so the
+// tessellation stages need no change
+uniform vec2 offset;
+
+// size of an EM for glyph patches stored in EM units, 1 otherwise
+uniform float scale;
+
 void main()
 {
-    // assign vertex position without modification
-    gl_Position = vec4(VertexPosition, 0.0, 1.0);
+    // place the control point at its character, then scroll it
+    gl_Position = vec4(VertexPosition * scale + InstancePosition + offset, 0.0, 1.0);
 
     // assign output colour to be interpolated
     tcColour = VertexColour;
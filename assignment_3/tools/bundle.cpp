@@ -0,0 +1,89 @@
+// ==========================================================================
+// Glyph Bundle Tool for Assignment 3
+//
+// Extracts every glyph outline, advance width and non-zero kerning pair of
+// each font given with FreeType, and writes them to a bundle next to the
+// font (see GlyphBundle.h), which the program then loads instead of the
+// font file.
+//
+// Build with "make bundles" to build the tool and bundle every font in
+// fonts/, or run it directly:
+//     ./a3_bundle.out [-j threads] <font file> [more font files...]
+// Outlines are extracted on one thread per core unless -j says otherwise.
+// ==========================================================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "GlyphExtractor.h"
+#include "GlyphBundle.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+bool bundleFont(const string &fontFile, int threads) {
+    GlyphExtractor extractor;
+    if (!extractor.LoadFontFile(fontFile))
+        return false;
+
+    // every character in the font, and the glyph drawn for those it lacks
+    vector<int> codes = extractor.CharacterCodes();
+    codes.push_back(BUNDLE_MISSING_GLYPH);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<GlyphOutline> outlines;
+    if (!ExtractOutlines(fontFile, codes, &outlines, threads))
+        return false;
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    vector<BundleKerning> kerning;
+    if (extractor.HasKerning()) {
+        for (size_t i = 0; i + 1 < codes.size(); i++) {
+            for (size_t j = 0; j + 1 < codes.size(); j++) {
+                BundleKerning pair;
+                pair.left = codes[i];
+                pair.right = codes[j];
+                pair.kerning = extractor.GetKerning(codes[i], codes[j]);
+                if (pair.kerning != 0.0f)
+                    kerning.push_back(pair);
+            }
+        }
+    }
+
+    string bundleFile = BundlePath(fontFile);
+    if (!WriteGlyphBundle(bundleFile, codes, outlines, kerning))
+        return false;
+
+    printf("%s: %zu glyphs (extracted in %.1f ms), %zu kerning pairs -> %s\n", fontFile.c_str(),
+           codes.size() - 1, ms, kerning.size(), bundleFile.c_str());
+    return true;
+}
+
+// ==========================================================================
+// PROGRAM ENTRY POINT
+
+int main(int argc, char *argv[]) {
+    int first = 1;
+    int threads = 0;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        threads = atoi(argv[2]);
+        first = 3;
+    }
+
+    if (first >= argc) {
+        printf("usage: %s [-j threads] <font file> [more font files...]\n", argv[0]);
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = first; i < argc; i++) {
+        if (!bundleFont(argv[i], threads))
+            failed++;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,305 @@
+// ==========================================================================
+// Intersection and Shading Kernel Microbenchmark for Assignment 4
+//
+// Drives the kernels in RayTracer.h with seeded random batches of rays and
+// primitives, away from the interactive app. Each kernel is run for a number
+// of timed repetitions, and the mean and standard deviation of the time per
+// test are reported alongside the hit rate.
+//
+// Build with "make bench", then run
+//     ./a4_bench.out [seed] [rays] [primitives] [repetitions]
+// ==========================================================================
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "RayTracer.h"
+#include "Scene.h"
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+// Benchmark Parameters
+
+struct BenchConfig {
+    unsigned int seed;
+    int rays;
+    int primitives;
+    int repetitions;
+    BenchConfig(): seed(453), rays(4096), primitives(64), repetitions(25) {}
+};
+
+// Timings for one kernel: time per test for every repetition, plus how many
+// of the tests in a single repetition reported a hit.
+struct KernelResult {
+    string kernel;
+    string variant;
+    vector<double> nsPerTest;
+    long long tests;
+    long long hits;
+    KernelResult(string k, string v): kernel(k), variant(v), tests(0), hits(0) {}
+};
+
+// written by every kernel loop so the compiler cannot discard the work
+volatile float sink;
+
+// --------------------------------------------------------------------------
+// Random Batch Generation
+
+vec3 randomVec3(mt19937 &rng, float lo, float hi) {
+    uniform_real_distribution<float> dist(lo, hi);
+    float x = dist(rng);
+    float y = dist(rng);
+    float z = dist(rng);
+    return vec3(x, y, z);
+}
+
+// unit directions pointing roughly down -z, like the camera rays of the app
+vector<Ray> generateRays(mt19937 &rng, int count) {
+    vector<Ray> rays;
+    rays.reserve(count);
+    for (int i = 0; i < count; i++) {
+        vec3 origin = randomVec3(rng, -0.5f, 0.5f);
+        vec3 direction = randomVec3(rng, -1.0f, 1.0f);
+        direction.z = -std::abs(direction.z) - 0.5f;
+        Ray r = Ray(origin, direction);
+        r.normalize();
+        rays.push_back(r);
+    }
+    return rays;
+}
+
+// primitives are scattered through the same box the scene files use
+vector<Sphere> generateSpheres(mt19937 &rng, int count) {
+    uniform_real_distribution<float> radius(0.1f, 1.0f);
+    vector<Sphere> spheres;
+    for (int i = 0; i < count; i++) {
+        vec3 center = randomVec3(rng, -2.75f, 2.75f);
+        center.z -= 7.75f;
+        float r = radius(rng);
+        spheres.push_back(Sphere(center, r, vec3(0.5f), vec3(0.5f)));
+    }
+    return spheres;
+}
+
+vector<Plane> generatePlanes(mt19937 &rng, int count) {
+    vector<Plane> planes;
+    for (int i = 0; i < count; i++) {
+        vec3 normal = normalize(randomVec3(rng, -1.0f, 1.0f));
+        vec3 point = randomVec3(rng, -2.75f, 2.75f);
+        point.z -= 7.75f;
+        planes.push_back(Plane(normal, point, vec3(0.5f), vec3(0.0f)));
+    }
+    return planes;
+}
+
+vector<Triangle> generateTriangles(mt19937 &rng, int count) {
+    vector<Triangle> triangles;
+    for (int i = 0; i < count; i++) {
+        vec3 center = randomVec3(rng, -2.75f, 2.75f);
+        center.z -= 7.75f;
+        vec3 a = center + randomVec3(rng, -1.0f, 1.0f);
+        vec3 b = center + randomVec3(rng, -1.0f, 1.0f);
+        vec3 c = center + randomVec3(rng, -1.0f, 1.0f);
+        triangles.push_back(Triangle(a, b, c, vec3(0.5f), vec3(0.0f)));
+    }
+    return triangles;
+}
+
+// --------------------------------------------------------------------------
+// Kernel Drivers
+
+typedef chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point start) {
+    return chrono::duration<double, nano>(Clock::now() - start).count();
+}
+
+// every ray against every primitive of one concrete type, so the calls are
+// resolved statically rather than through the Shape vtable
+template <typename T>
+KernelResult benchIntersect(const string &name, vector<Ray> &rays, vector<T> &prims,
+                            const BenchConfig &config) {
+    KernelResult result(name, "scalar");
+    result.tests = (long long)rays.size() * prims.size();
+
+    for (int rep = 0; rep < config.repetitions; rep++) {
+        long long hits = 0;
+        float acc = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < rays.size(); i++) {
+            for (size_t j = 0; j < prims.size(); j++) {
+                float t = prims[j].intersect(rays[i], 0);
+                if (t < INFINITY) {
+                    hits++;
+                    acc += t;
+                }
+            }
+        }
+        result.nsPerTest.push_back(elapsedNs(start) / result.tests);
+        result.hits = hits;
+        sink = acc;
+    }
+    return result;
+}
+
+// the same tests dispatched through Shape*, as the tracer does
+KernelResult benchIntersectVirtual(vector<Ray> &rays, vector<Shape*> &shapes,
+                                   const BenchConfig &config) {
+    KernelResult result("Shape::intersect", "virtual");
+    result.tests = (long long)rays.size() * shapes.size();
+
+    for (int rep = 0; rep < config.repetitions; rep++) {
+        long long hits = 0;
+        float acc = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < rays.size(); i++) {
+            for (size_t j = 0; j < shapes.size(); j++) {
+                float t = shapes[j]->intersect(rays[i], 0);
+                if (t < INFINITY) {
+                    hits++;
+                    acc += t;
+                }
+            }
+        }
+        result.nsPerTest.push_back(elapsedNs(start) / result.tests);
+        result.hits = hits;
+        sink = acc;
+    }
+    return result;
+}
+
+KernelResult benchMagnitude(vector<Ray> &rays, const BenchConfig &config) {
+    KernelResult result("findMagnitude", "scalar");
+    result.tests = rays.size();
+
+    for (int rep = 0; rep < config.repetitions; rep++) {
+        float acc = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < rays.size(); i++)
+            acc += findMagnitude(rays[i].origin);
+        result.nsPerTest.push_back(elapsedNs(start) / result.tests);
+        sink = acc;
+    }
+    return result;
+}
+
+// closest hit against the whole scene through its BVHs
+KernelResult benchScene(vector<Ray> &rays, Scene &scene, const BenchConfig &config) {
+    KernelResult result("Scene::intersect", "bvh");
+    result.tests = rays.size();
+
+    for (int rep = 0; rep < config.repetitions; rep++) {
+        long long hits = 0;
+        float acc = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < rays.size(); i++) {
+            Hit hit;
+            if (scene.intersect(rays[i], 0, &hit)) {
+                hits++;
+                acc += hit.t;
+            }
+        }
+        result.nsPerTest.push_back(elapsedNs(start) / result.tests);
+        result.hits = hits;
+        sink = acc;
+    }
+    return result;
+}
+
+// full local shading (closest hit, Blinn-Phong and shadow ray) of one ray
+KernelResult benchShade(vector<Ray> &rays, Scene &scene, const BenchConfig &config) {
+    KernelResult result("shadeRay", "scalar");
+    result.tests = rays.size();
+
+    for (int rep = 0; rep < config.repetitions; rep++) {
+        long long hits = 0;
+        float acc = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < rays.size(); i++) {
+            vec3 ks;
+            Ray reflected = Ray(vec3(0, 0, 0), vec3(0, 0, 0));
+            vec3 L = shadeRay(rays[i], scene, &ks, &reflected);
+            if (L != vec3(0, 0, 0))
+                hits++;
+            acc += L.x + L.y + L.z;
+        }
+        result.nsPerTest.push_back(elapsedNs(start) / result.tests);
+        result.hits = hits;
+        sink = acc;
+    }
+    return result;
+}
+
+// --------------------------------------------------------------------------
+// Reporting
+
+void printResult(const KernelResult &r) {
+    double mean = 0;
+    for (size_t i = 0; i < r.nsPerTest.size(); i++)
+        mean += r.nsPerTest[i];
+    mean /= r.nsPerTest.size();
+
+    double variance = 0;
+    for (size_t i = 0; i < r.nsPerTest.size(); i++)
+        variance += (r.nsPerTest[i] - mean) * (r.nsPerTest[i] - mean);
+    variance /= r.nsPerTest.size();
+
+    double hitRate = r.tests ? 100.0 * r.hits / r.tests : 0;
+
+    printf("%-20s %-8s %10.3f %10.4f %10.3f %8.2f%%\n", r.kernel.c_str(), r.variant.c_str(),
+           mean, variance, std::sqrt(variance), hitRate);
+}
+
+// ==========================================================================
+// PROGRAM ENTRY POINT
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    if (argc > 1) config.seed = strtoul(argv[1], 0, 10);
+    if (argc > 2) config.rays = atoi(argv[2]);
+    if (argc > 3) config.primitives = atoi(argv[3]);
+    if (argc > 4) config.repetitions = atoi(argv[4]);
+
+    mt19937 rng(config.seed);
+    vector<Ray> rays = generateRays(rng, config.rays);
+    vector<Sphere> spheres = generateSpheres(rng, config.primitives);
+    vector<Plane> planes = generatePlanes(rng, config.primitives);
+    vector<Triangle> triangles = generateTriangles(rng, config.primitives);
+
+    vector<Shape*> shapes;
+    for (int i = 0; i < config.primitives; i++) {
+        shapes.push_back(&spheres[i]);
+        shapes.push_back(&planes[i]);
+        shapes.push_back(&triangles[i]);
+    }
+
+    // the scene owns its shapes, so it gets copies of the bounded ones
+    Scene scene;
+    scene.light = Light(vec3(0, 2.5f, -7.75f), 0.8f);
+    for (int i = 0; i < config.primitives; i++) {
+        scene.world.add(new Sphere(spheres[i]));
+        scene.world.add(new Triangle(triangles[i]));
+    }
+    scene.build();
+
+    printf("seed %u, %d rays, %d primitives of each type, %d repetitions\n\n",
+           config.seed, config.rays, config.primitives, config.repetitions);
+    printf("%-20s %-8s %10s %10s %10s %9s\n", "kernel", "variant", "ns/test", "variance", "stddev", "hit rate");
+
+    printResult(benchIntersect("Sphere::intersect", rays, spheres, config));
+    printResult(benchIntersect("Plane::intersect", rays, planes, config));
+    printResult(benchIntersect("Triangle::intersect", rays, triangles, config));
+    printResult(benchIntersectVirtual(rays, shapes, config));
+    printResult(benchMagnitude(rays, config));
+    printResult(benchScene(rays, scene, config));
+    printResult(benchShade(rays, scene, config));
+
+    return 0;
+}
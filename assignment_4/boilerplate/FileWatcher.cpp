@@ -0,0 +1,85 @@
+// ==========================================================================
+// Scene File Watching for Assignment 4
+// ==========================================================================
+
+#include "FileWatcher.h"
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+FileWatcher::FileWatcher()
+    : fd(-1), watchID(-1)
+{
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK);
+    if (fd < 0)
+        cout << "ERROR: inotify failed to initialize, scene reloading disabled" << endl;
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+// --------------------------------------------------------------------------
+
+bool FileWatcher::watch(const string &path)
+{
+#ifdef __linux__
+    if (fd < 0)
+        return false;
+
+    if (watchID >= 0)
+        inotify_rm_watch(fd, watchID);
+
+    size_t slash = path.find_last_of('/');
+    string directory = slash == string::npos ? "." : path.substr(0, slash);
+    filename = slash == string::npos ? path : path.substr(slash + 1);
+
+    watchID = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchID < 0) {
+        cout << "ERROR: Could not watch " << directory << " for changes" << endl;
+        return false;
+    }
+
+    // drop anything queued for the previous file
+    changed();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool FileWatcher::changed()
+{
+    bool found = false;
+#ifdef __linux__
+    if (fd < 0)
+        return false;
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->wd == watchID && event->len > 0 && filename == event->name)
+                found = true;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+    return found;
+}
+
+// --------------------------------------------------------------------------
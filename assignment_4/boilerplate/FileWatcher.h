@@ -0,0 +1,36 @@
+// ==========================================================================
+// Scene File Watching for Assignment 4
+//
+// Watches a single file for modifications using inotify on Linux. The watch
+// is on the containing directory, so editors that save by writing a new file
+// and renaming it over the old one are picked up as well. On other platforms
+// changed() always returns false.
+// ==========================================================================
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <string>
+
+class FileWatcher
+{
+    int fd;
+    int watchID;
+    std::string filename;
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // starts watching path, replacing any previous watch
+    bool watch(const std::string &path);
+
+    // non-blocking; true if the file was saved since the last call
+    bool changed();
+
+private:
+    FileWatcher(const FileWatcher &);
+    FileWatcher &operator=(const FileWatcher &);
+};
+
+// --------------------------------------------------------------------------
+#endif // FILEWATCHER_H
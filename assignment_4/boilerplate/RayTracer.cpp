@@ -0,0 +1,88 @@
+// ==========================================================================
+// Ray Tracing Kernels for Assignment 4
+// ==========================================================================
+
+#include "RayTracer.h"
+#include "Scene.h"
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+float max(float a, float b) {
+    if (a > b) {
+        return a;
+    }
+    return b;
+}
+
+// --------------------------------------------------------------------------
+
+vec3 shadeRay(const Ray &r, const Scene &scene, vec3 *specular, Ray *reflected) {
+    const Light &light = scene.light;
+    vec3 kd;
+    vec3 ks;
+    vec3 normal;
+    vec3 incidentPoint;
+
+    float I = light.intensity;
+    float Ia = 0.5;
+
+    Hit hit;
+    if (!scene.intersect(r, 0, &hit)) {
+        *specular = vec3(0, 0, 0);
+        return vec3(0, 0, 0);
+    }
+
+    incidentPoint = r.origin + hit.t * r.direction;
+    kd = hit.shape->colour;
+    ks = hit.shape->specColour;
+    normal = hit.instance->getNormal(hit.shape, incidentPoint);
+
+    vec3 l = light.position - incidentPoint;
+
+    l /= findMagnitude(l);
+    vec3 v = r.origin - incidentPoint;
+    v /= findMagnitude(v);
+    normal /= findMagnitude(normal);
+
+    vec3 h = (v + l) / findMagnitude(v + l);
+    vec3 ka = kd;
+
+    vec3 L = ka * Ia + kd * I * max(0, dot(normal, l)) + ks * I * max(0, pow(dot(normal, h), 100));
+
+    Ray shadowRay = Ray(incidentPoint, l);
+    shadowRay.normalize();
+    // the shadow ray stops just short of the light as well as starting just
+    // off the surface, so a surface the light sits on does not shadow it
+    Hit blocker;
+    if (scene.intersect(shadowRay, 0.0001f, &blocker) &&
+        blocker.t < findMagnitude(light.position - shadowRay.origin) - 0.0001f) {
+        L = ka * Ia;
+    }
+
+    vec3 rhs = 2 * dot(r.direction, normal) *  normal;
+    *reflected = Ray(incidentPoint, r.direction - rhs);
+    reflected->origin += 0.0001f * reflected->direction;
+    reflected->normalize();
+
+    *specular = ks;
+    return L;
+}
+
+vec3 getPixelColour(Ray r, const Scene &scene, int count) {
+    vec3 ks;
+    Ray reflectedRay = Ray(vec3(0, 0, 0), vec3(0, 0, 0));
+
+    vec3 L = shadeRay(r, scene, &ks, &reflectedRay);
+
+    if (findMagnitude(ks) > 0 && count < MAX_BOUNCES) {
+        vec3 ref = getPixelColour(reflectedRay, scene, ++count);
+        L = L + ks * ref;
+    }
+
+    return L;
+}
+
+// --------------------------------------------------------------------------
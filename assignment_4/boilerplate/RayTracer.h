@@ -0,0 +1,284 @@
+// ==========================================================================
+// Ray Tracing Kernels for Assignment 4
+//
+// Rays, lights and the shape primitives along with their intersection and
+// shading code. This module has no OpenGL dependencies so the kernels can be
+// driven directly by the benchmark in benchmark/bench.cpp.
+// ==========================================================================
+#ifndef RAYTRACER_H
+#define RAYTRACER_H
+
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+
+// maximum number of reflections followed from a primary ray
+const int MAX_BOUNCES = 10;
+
+// --------------------------------------------------------------------------
+// Math Functions
+
+inline float findMagnitude(glm::vec3 v) {
+    return std::sqrt(std::pow(v.x, 2) + std::pow(v.y, 2) + std::pow(v.z, 2));
+}
+
+inline glm::vec3 crossProduct(glm::vec3 a, glm::vec3 b) {
+    return glm::vec3(a.y * b.z - a.z * b.y,
+                     a.z * b.x - a.x * b.z,
+                     a.x * b.y - a.y * b.x);
+}
+
+inline float dotProduct(glm::vec3 a, glm::vec3 b) {
+    return (a.x * b.x + a.y * b.y + a.z * b.z);
+}
+
+inline float findDiscriminant(float a, float b, float c) {
+    return std::pow(b, 2) -  a * c;
+}
+
+// --------------------------------------------------------------------------
+// Support Classes
+
+// An axis aligned bounding box, empty (lo > hi) until something is added.
+class AABB {
+public:
+    glm::vec3 lo;
+    glm::vec3 hi;
+    AABB(): lo(INFINITY, INFINITY, INFINITY), hi(-INFINITY, -INFINITY, -INFINITY) {}
+    AABB(glm::vec3 l, glm::vec3 h): lo(l), hi(h) {}
+
+    void grow(glm::vec3 p) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+
+    void grow(const AABB &b) {
+        lo = glm::min(lo, b.lo);
+        hi = glm::max(hi, b.hi);
+    }
+
+    bool empty() const {
+        return lo.x > hi.x || lo.y > hi.y || lo.z > hi.z;
+    }
+
+    glm::vec3 centroid() const {
+        return 0.5f * (lo + hi);
+    }
+
+    // slab test against the ray parameter interval [tmin, tmax]
+    bool hit(const glm::vec3 &origin, const glm::vec3 &invDir, float tmin, float tmax) const {
+        for (int k = 0; k < 3; k++) {
+            float t0 = (lo[k] - origin[k]) * invDir[k];
+            float t1 = (hi[k] - origin[k]) * invDir[k];
+            if (invDir[k] < 0) {
+                float tmp = t0;
+                t0 = t1;
+                t1 = tmp;
+            }
+            tmin = t0 > tmin ? t0 : tmin;
+            tmax = t1 < tmax ? t1 : tmax;
+            if (tmax < tmin)
+                return false;
+        }
+        return true;
+    }
+};
+
+class Ray {
+public:
+    glm::vec3 origin;
+    glm::vec3 direction;
+    Ray(glm::vec3 o, glm::vec3 d): origin(o), direction(d){}
+    void normalize() {
+        float mag = findMagnitude(direction);
+        direction.x /= mag;
+        direction.y /= mag;
+        direction.z /= mag;
+    }
+};
+
+class Light {
+public:
+	glm::vec3 position;
+    float intensity;
+    Light(glm::vec3 p, float i): position(p), intensity(i) {}
+};
+
+class Shape {
+public:
+    glm::vec3 colour;
+    glm::vec3 specColour;
+    Shape(glm::vec3 c, glm::vec3 spc): colour(c), specColour(spc) {}
+    virtual float intersect(Ray r, float min) = 0;
+    virtual glm::vec3 getNormal(glm::vec3 point) = 0;
+    // bounding box of the shape, empty for shapes of infinite extent
+    virtual AABB bounds() const = 0;
+    // true if other is the same kind of shape with identical parameters
+    virtual bool equals(const Shape *other) const = 0;
+    virtual ~Shape() {}
+};
+
+class Sphere: public Shape {
+public:
+    glm::vec3 center;
+    float radius;
+    Sphere(glm::vec3 c, float r, glm::vec3 co, glm::vec3 spc): Shape(co, spc), center(c), radius(r) {}
+    float intersect(Ray r, float min) {
+        glm::vec3 originToCenter = r.origin - center;
+
+        float a = dotProduct(r.direction, r.direction);
+        float b = dotProduct(r.direction, originToCenter);
+        float c = dotProduct(originToCenter, originToCenter) - std::pow(radius, 2);
+
+        float discriminant = findDiscriminant(a, b, c);
+        if (discriminant < 0) {
+            return INFINITY;
+        }
+
+        float t;
+        float t0 = (-b + std::sqrt(discriminant)) /  a;
+        float t1 = (-b - std::sqrt(discriminant)) / a;
+
+        (t0 < t1) ? t = t0 : t = t1;
+        if (t < min) {
+            return INFINITY;
+        }
+
+        return t;
+    }
+
+    glm::vec3 getNormal(glm::vec3 point) {
+        return point - center;
+    }
+
+    AABB bounds() const {
+        glm::vec3 r(radius, radius, radius);
+        return AABB(center - r, center + r);
+    }
+
+    bool equals(const Shape *other) const {
+        const Sphere *s = dynamic_cast<const Sphere*>(other);
+        return s && s->center == center && s->radius == radius &&
+               s->colour == colour && s->specColour == specColour;
+    }
+};
+
+class Plane: public Shape {
+public:
+    glm::vec3 normal;
+    glm::vec3 pointQ;
+    Plane(glm::vec3 n, glm::vec3 q, glm::vec3 co, glm::vec3 spc): Shape(co, spc), normal(n), pointQ(q) {}
+    float intersect(Ray r, float min) {
+        float bottom = glm::dot(r.direction, normal);
+        if (bottom == 0) {
+            return INFINITY;
+        }
+
+        float t = glm::dot(pointQ - r.origin, normal) / bottom;
+        if (t > min) {
+            return t;
+        }
+        return INFINITY;
+    }
+
+    glm::vec3 getNormal(glm::vec3 point) {
+        return normal;
+    }
+
+    AABB bounds() const {
+        return AABB();
+    }
+
+    bool equals(const Shape *other) const {
+        const Plane *p = dynamic_cast<const Plane*>(other);
+        return p && p->normal == normal && p->pointQ == pointQ &&
+               p->colour == colour && p->specColour == specColour;
+    }
+};
+
+class Triangle: public Shape {
+public:
+    glm::vec3 pointA;
+    glm::vec3 pointB;
+    glm::vec3 pointC;
+    Triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 co, glm::vec3 spc):
+        Shape(co, spc), pointA(a), pointB(b), pointC(c) {}
+    float intersect(Ray r, float min) {
+		glm::vec3 ve = r.origin;
+		glm::vec3 vd = r.direction;
+		glm::vec3 pa = pointA;
+		glm::vec3 pb = pointB;
+		glm::vec3 pc = pointC;
+
+		float a = pa.x - pb.x;
+		float b = pa.y - pb.y;
+		float c = pa.z - pb.z;
+		float d = pa.x - pc.x;
+		float e = pa.y - pc.y;
+		float f = pa.z - pc.z;
+		float g = vd.x;
+		float h = vd.y;
+		float i = vd.z;
+		float j = pa.x - ve.x;
+		float k = pa.y - ve.y;
+		float l = pa.z - ve.z;
+
+		float M = a * (e * i - h * f) + b * (g * f - d * i) + c * (d * h - e * g);
+
+		float t = -(f * (a * k - j * b) + e * (j * c - a * l) + d * (b * l - k * c)) / M;
+		float u = (i * (a * k - j * b) + h * (j * c - a * l) + g * (b * l - k * c)) / M;
+		float v = (j * (e * i - h * f) + k * (g * f - d * i) + l * (d * h - e * g)) / M;
+
+		if (t < min || u < 0 || u > 1 || v < 0 || (u + v) > 1) {
+            return INFINITY;
+        }
+
+		return t;
+    }
+
+    glm::vec3 getNormal(glm::vec3 point) {
+        glm::vec3 vab = pointB - pointA;
+        glm::vec3 vac = pointC - pointA;
+        return crossProduct(vab, vac);
+    }
+
+    AABB bounds() const {
+        AABB box;
+        box.grow(pointA);
+        box.grow(pointB);
+        box.grow(pointC);
+        return box;
+    }
+
+    bool equals(const Shape *other) const {
+        const Triangle *tr = dynamic_cast<const Triangle*>(other);
+        return tr && tr->pointA == pointA && tr->pointB == pointB && tr->pointC == pointC &&
+               tr->colour == colour && tr->specColour == specColour;
+    }
+};
+
+class Instance;
+class Scene;
+
+// The closest surface found along a ray: the ray parameter, the primitive that
+// was hit, and the instance that placed that primitive in the world.
+struct Hit {
+    float t;
+    Shape *shape;
+    const Instance *instance;
+    Hit(): t(INFINITY), shape(0), instance(0) {}
+};
+
+// --------------------------------------------------------------------------
+// Shading Functions
+
+// finds the closest hit along r and returns its ambient, diffuse and specular
+// colour. The specular colour and reflected ray are passed back so callers
+// can decide how (and in what order) to continue the path.
+glm::vec3 shadeRay(const Ray &r, const Scene &scene, glm::vec3 *specular, Ray *reflected);
+
+// recursively traces r and its reflections, up to MAX_BOUNCES deep
+glm::vec3 getPixelColour(Ray r, const Scene &scene, int count);
+
+// --------------------------------------------------------------------------
+#endif // RAYTRACER_H
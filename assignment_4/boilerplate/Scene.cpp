@@ -0,0 +1,686 @@
+// ==========================================================================
+// Scene Description and Acceleration Structures for Assignment 4
+// ==========================================================================
+
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace std;
+using namespace glm;
+
+// maximum number of items stored in a BVH leaf
+const int LEAF_SIZE = 4;
+
+// --------------------------------------------------------------------------
+// BVH
+
+void BVH::build(const vector<AABB> &boxes) {
+    nodes.clear();
+    order.resize(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++)
+        order[i] = i;
+
+    if (boxes.empty())
+        return;
+
+    nodes.reserve(2 * boxes.size());
+    buildNode(boxes, 0, boxes.size());
+}
+
+// splits at the median centroid along the longest axis of the centroid bounds
+int BVH::buildNode(const vector<AABB> &boxes, int begin, int end) {
+    int index = nodes.size();
+    nodes.push_back(Node());
+
+    AABB box;
+    AABB centroids;
+    for (int i = begin; i < end; i++) {
+        box.grow(boxes[order[i]]);
+        centroids.grow(boxes[order[i]].centroid());
+    }
+    nodes[index].box = box;
+
+    vec3 extent = centroids.hi - centroids.lo;
+    int axis = 0;
+    if (extent.y > extent[axis]) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    if (end - begin <= LEAF_SIZE || extent[axis] <= 0) {
+        nodes[index].first = begin;
+        nodes[index].count = end - begin;
+        return index;
+    }
+
+    int mid = (begin + end) / 2;
+    nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                [&](int a, int b) { return boxes[a].centroid()[axis] < boxes[b].centroid()[axis]; });
+
+    buildNode(boxes, begin, mid);
+    int right = buildNode(boxes, mid, end);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+// children always follow their parent, so walking the nodes backwards visits
+// both children before the node itself
+void BVH::refit(const vector<AABB> &boxes) {
+    for (int index = nodes.size() - 1; index >= 0; index--) {
+        Node &node = nodes[index];
+        node.box = AABB();
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++)
+                node.box.grow(boxes[order[i]]);
+        } else {
+            node.box.grow(nodes[index + 1].box);
+            node.box.grow(nodes[node.first].box);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+// ObjectDef
+
+ObjectDef::~ObjectDef() {
+    for (size_t i = 0; i < shapes.size(); i++)
+        delete shapes[i];
+    for (size_t i = 0; i < unbounded.size(); i++)
+        delete unbounded[i];
+}
+
+void ObjectDef::add(Shape *shape) {
+    if (shape->bounds().empty())
+        unbounded.push_back(shape);
+    else
+        shapes.push_back(shape);
+}
+
+void ObjectDef::build() {
+    vector<AABB> boxes;
+    bounds = AABB();
+    for (size_t i = 0; i < shapes.size(); i++) {
+        boxes.push_back(shapes[i]->bounds());
+        bounds.grow(boxes.back());
+    }
+    bvh.build(boxes);
+}
+
+void ObjectDef::refit() {
+    vector<AABB> boxes;
+    bounds = AABB();
+    for (size_t i = 0; i < shapes.size(); i++) {
+        boxes.push_back(shapes[i]->bounds());
+        bounds.grow(boxes.back());
+    }
+    bvh.refit(boxes);
+}
+
+bool ObjectDef::intersect(const Ray &r, float min, Hit *hit) const {
+    bool found = false;
+
+    for (size_t i = 0; i < unbounded.size(); i++) {
+        float t = unbounded[i]->intersect(r, min);
+        if (t < hit->t) {
+            hit->t = t;
+            hit->shape = unbounded[i];
+            found = true;
+        }
+    }
+
+    if (!shapes.empty()) {
+        vec3 invDir = 1.0f / r.direction;
+        bvh.traverse(r, invDir, min, hit->t, [&](int i) {
+            float t = shapes[i]->intersect(r, min);
+            if (t < hit->t) {
+                hit->t = t;
+                hit->shape = shapes[i];
+                found = true;
+            }
+        });
+    }
+
+    return found;
+}
+
+// --------------------------------------------------------------------------
+// Animation
+
+mat4 Animation::at(float time) const {
+    if (keys.empty())
+        return before * after;
+
+    size_t next = 0;
+    while (next < keys.size() && keys[next].time <= time)
+        next++;
+
+    Keyframe key;
+    if (next == 0) {
+        key = keys.front();
+    } else if (next == keys.size()) {
+        key = keys.back();
+    } else {
+        const Keyframe &a = keys[next - 1];
+        const Keyframe &b = keys[next];
+        float u = (time - a.time) / (b.time - a.time);
+        key.translation = mix(a.translation, b.translation, u);
+        key.angle = mix(a.angle, b.angle, u);
+        key.axis = mix(a.axis, b.axis, u);
+        key.scale = mix(a.scale, b.scale, u);
+        if (length(key.axis) == 0)
+            key.axis = b.axis;
+    }
+
+    mat4 transform = translate(before, key.translation);
+    transform = rotate(transform, radians(key.angle), key.axis);
+    transform = scale(transform, key.scale);
+    return transform * after;
+}
+
+// --------------------------------------------------------------------------
+// Instance
+
+Instance::Instance(const ObjectDef *o, const mat4 &transform): object(o) {
+    setTransform(transform);
+}
+
+void Instance::setTransform(const mat4 &transform) {
+    toWorld = transform;
+    toObject = inverse(transform);
+    identity = transform == mat4(1.0f);
+    updateBounds();
+}
+
+AABB transformBox(const AABB &box, const mat4 &transform) {
+    AABB result;
+    if (box.empty())
+        return result;
+
+    for (int c = 0; c < 8; c++) {
+        vec3 corner((c & 1) ? box.hi.x : box.lo.x,
+                    (c & 2) ? box.hi.y : box.lo.y,
+                    (c & 4) ? box.hi.z : box.lo.z);
+        result.grow(vec3(transform * vec4(corner, 1)));
+    }
+    return result;
+}
+
+void Instance::updateBounds() {
+    bounds = transformBox(object->bounds, toWorld);
+}
+
+bool Instance::intersect(const Ray &r, float min, Hit *hit) const {
+    bool found;
+    if (identity) {
+        found = object->intersect(r, min, hit);
+    } else {
+        Ray local = Ray(vec3(toObject * vec4(r.origin, 1)), vec3(toObject * vec4(r.direction, 0)));
+        found = object->intersect(local, min, hit);
+    }
+
+    if (found)
+        hit->instance = this;
+    return found;
+}
+
+vec3 Instance::getNormal(Shape *shape, vec3 point) const {
+    if (identity)
+        return shape->getNormal(point);
+
+    vec3 local = vec3(toObject * vec4(point, 1));
+    return mat3(transpose(toObject)) * shape->getNormal(local);
+}
+
+// --------------------------------------------------------------------------
+// Scene
+
+Scene::Scene(): light(vec3(0, 0, 0), 0), world("world") {
+    instances.push_back(Instance(&world, mat4(1.0f)));
+}
+
+Scene::~Scene() {
+    for (size_t i = 0; i < objects.size(); i++)
+        delete objects[i];
+}
+
+ObjectDef *Scene::findObject(const string &name) const {
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (objects[i]->name == name)
+            return objects[i];
+    }
+    return 0;
+}
+
+void Scene::build() {
+    world.build();
+    for (size_t i = 0; i < objects.size(); i++)
+        objects[i]->build();
+
+    vector<AABB> boxes;
+    bounded.clear();
+    unbounded.clear();
+    for (size_t i = 0; i < instances.size(); i++) {
+        Instance &instance = instances[i];
+        instance.updateBounds();
+        if (!instance.object->unbounded.empty()) {
+            unbounded.push_back(i);
+        } else if (!instance.bounds.empty()) {
+            bounded.push_back(i);
+            boxes.push_back(instance.bounds);
+        }
+    }
+    top.build(boxes);
+}
+
+// checks that both scenes hold the same objects, instances and primitive
+// counts, so that primitives and instances correspond by index
+bool sameStructure(const ObjectDef &a, const ObjectDef &b) {
+    return a.name == b.name && a.shapes.size() == b.shapes.size() &&
+           a.unbounded.size() == b.unbounded.size();
+}
+
+bool Scene::update(Scene *edited, SceneChanges *changes) {
+    if (objects.size() != edited->objects.size() || instances.size() != edited->instances.size())
+        return false;
+    if (!sameStructure(world, edited->world))
+        return false;
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (!sameStructure(*objects[i], *edited->objects[i]))
+            return false;
+    }
+    for (size_t i = 0; i < instances.size(); i++) {
+        if (instances[i].object->name != edited->instances[i].object->name)
+            return false;
+    }
+
+    if (light.position != edited->light.position || light.intensity != edited->light.intensity) {
+        light = edited->light;
+        changes->everything = true;
+    }
+
+    // swap changed primitives over, leaving the stale ones to be freed with edited
+    vector<ObjectDef*> mine;
+    vector<ObjectDef*> theirs;
+    mine.push_back(&world);
+    theirs.push_back(&edited->world);
+    mine.insert(mine.end(), objects.begin(), objects.end());
+    theirs.insert(theirs.end(), edited->objects.begin(), edited->objects.end());
+
+    vector<bool> moved(mine.size(), false);
+    for (size_t o = 0; o < mine.size(); o++) {
+        ObjectDef *object = mine[o];
+        ObjectDef *other = theirs[o];
+
+        for (size_t i = 0; i < object->unbounded.size(); i++) {
+            if (!object->unbounded[i]->equals(other->unbounded[i])) {
+                swap(object->unbounded[i], other->unbounded[i]);
+                changes->everything = true;
+            }
+        }
+
+        for (size_t i = 0; i < object->shapes.size(); i++) {
+            if (object->shapes[i]->equals(other->shapes[i]))
+                continue;
+
+            AABB before = object->shapes[i]->bounds();
+            AABB after = other->shapes[i]->bounds();
+            swap(object->shapes[i], other->shapes[i]);
+            moved[o] = true;
+
+            for (size_t k = 0; k < instances.size(); k++) {
+                if (instances[k].object != object)
+                    continue;
+                changes->regions.push_back(transformBox(before, instances[k].toWorld));
+                changes->regions.push_back(transformBox(after, instances[k].toWorld));
+            }
+        }
+
+        if (moved[o])
+            object->refit();
+    }
+
+    bool topMoved = false;
+    for (size_t i = 0; i < instances.size(); i++) {
+        Instance &instance = instances[i];
+        const Instance &other = edited->instances[i];
+        bool objectMoved = false;
+        for (size_t o = 0; o < mine.size(); o++)
+            objectMoved = objectMoved || (moved[o] && mine[o] == instance.object);
+
+        instance.animation = other.animation;
+        if (instance.toWorld != other.toWorld) {
+            // the bounds of an instance leave out its planes, which can
+            // cover any part of the screen
+            if (!instance.object->unbounded.empty())
+                changes->everything = true;
+            changes->regions.push_back(instance.bounds);
+            instance.setTransform(other.toWorld);
+            changes->regions.push_back(instance.bounds);
+            topMoved = true;
+        } else if (objectMoved) {
+            instance.updateBounds();
+            topMoved = true;
+        }
+    }
+
+    if (topMoved) {
+        vector<AABB> boxes;
+        for (size_t i = 0; i < bounded.size(); i++)
+            boxes.push_back(instances[bounded[i]].bounds);
+        top.refit(boxes);
+    }
+
+    return true;
+}
+
+bool Scene::timeRange(float *start, float *end) const {
+    bool animated = false;
+    for (size_t i = 0; i < instances.size(); i++) {
+        const vector<Keyframe> &keys = instances[i].animation.keys;
+        if (keys.empty())
+            continue;
+        if (!animated || keys.front().time < *start)
+            *start = keys.front().time;
+        if (!animated || keys.back().time > *end)
+            *end = keys.back().time;
+        animated = true;
+    }
+    return animated;
+}
+
+void Scene::animate(float time, SceneChanges *changes) {
+    bool moved = false;
+    for (size_t i = 0; i < instances.size(); i++) {
+        Instance &instance = instances[i];
+        if (instance.animation.empty())
+            continue;
+
+        mat4 transform = instance.animation.at(time);
+        if (transform == instance.toWorld)
+            continue;
+
+        if (changes && !instance.object->unbounded.empty())
+            changes->everything = true;
+        if (changes)
+            changes->regions.push_back(instance.bounds);
+        instance.setTransform(transform);
+        if (changes)
+            changes->regions.push_back(instance.bounds);
+        moved = true;
+    }
+
+    if (moved) {
+        vector<AABB> boxes;
+        for (size_t i = 0; i < bounded.size(); i++)
+            boxes.push_back(instances[bounded[i]].bounds);
+        top.refit(boxes);
+    }
+}
+
+bool Scene::reflectors(vector<AABB> *boxes) const {
+    bool bounded = true;
+    for (size_t i = 0; i < instances.size(); i++) {
+        const ObjectDef *object = instances[i].object;
+        for (size_t k = 0; k < object->unbounded.size(); k++) {
+            if (findMagnitude(object->unbounded[k]->specColour) > 0)
+                bounded = false;
+        }
+        for (size_t k = 0; k < object->shapes.size(); k++) {
+            if (findMagnitude(object->shapes[k]->specColour) > 0)
+                boxes->push_back(transformBox(object->shapes[k]->bounds(), instances[i].toWorld));
+        }
+    }
+    return bounded;
+}
+
+bool Scene::intersect(const Ray &r, float min, Hit *hit) const {
+    bool found = false;
+
+    for (size_t i = 0; i < unbounded.size(); i++) {
+        if (instances[unbounded[i]].intersect(r, min, hit))
+            found = true;
+    }
+
+    vec3 invDir = 1.0f / r.direction;
+    top.traverse(r, invDir, min, hit->t, [&](int item) {
+        if (instances[bounded[item]].intersect(r, min, hit))
+            found = true;
+    });
+
+    return found;
+}
+
+// --------------------------------------------------------------------------
+// File Parsing Functions
+
+// consumes lines up to and including the closing brace of the current block
+void skipBlock(ifstream &f) {
+    string line;
+    while (getline(f, line)) {
+        if (line.find("}") != string::npos)
+            return;
+    }
+}
+
+// reads the keyword a line starts with, as in "sphere {" or "object chair {"
+string parseKeyword(const string &line) {
+    char keyword[64];
+    if (sscanf(line.c_str(), " %63[^ \t{]", keyword) != 1)
+        return "";
+    return keyword;
+}
+
+// reads the name following a keyword, as in "object chair {"
+string parseName(const string &line) {
+    char keyword[64];
+    char name[256];
+    if (sscanf(line.c_str(), "%63s %255[^ \t{]", keyword, name) != 2)
+        return "";
+    return name;
+}
+
+// reads the lines of a "key time {" block inside an instance
+Keyframe parseKey(ifstream &f, float time) {
+    Keyframe key;
+    key.time = time;
+    string line;
+    while (getline(f, line) && line.find("}") == string::npos) {
+        float x, y, z, a;
+        if (sscanf(line.c_str(), " translate %f %f %f", &x, &y, &z) == 3) {
+            key.translation = vec3(x, y, z);
+        } else if (sscanf(line.c_str(), " rotate %f %f %f %f", &a, &x, &y, &z) == 4) {
+            key.angle = a;
+            key.axis = vec3(x, y, z);
+        } else if (sscanf(line.c_str(), " scale %f %f %f", &x, &y, &z) == 3) {
+            key.scale = vec3(x, y, z);
+        } else if (sscanf(line.c_str(), " scale %f", &a) == 1) {
+            key.scale = vec3(a, a, a);
+        }
+    }
+    return key;
+}
+
+// instance transforms are applied to the object in the reverse of the order
+// they are listed, as with OpenGL matrix calls. Key blocks are gathered into
+// animation, splitting the other lines into those before and after them.
+mat4 parseTransform(ifstream &f, Animation *animation) {
+    mat4 transform(1.0f);
+    string line;
+    while (getline(f, line) && line.find("}") == string::npos) {
+        float x, y, z, a;
+        if (sscanf(line.c_str(), " key %f", &a) == 1) {
+            if (animation->keys.empty()) {
+                animation->before = transform;
+                transform = mat4(1.0f);
+            }
+            animation->keys.push_back(parseKey(f, a));
+        } else if (sscanf(line.c_str(), " translate %f %f %f", &x, &y, &z) == 3) {
+            transform = translate(transform, vec3(x, y, z));
+        } else if (sscanf(line.c_str(), " rotate %f %f %f %f", &a, &x, &y, &z) == 4) {
+            transform = rotate(transform, radians(a), vec3(x, y, z));
+        } else if (sscanf(line.c_str(), " scale %f %f %f", &x, &y, &z) == 3) {
+            transform = scale(transform, vec3(x, y, z));
+        } else if (sscanf(line.c_str(), " scale %f", &a) == 1) {
+            transform = scale(transform, vec3(a, a, a));
+        }
+    }
+
+    if (animation->empty())
+        return transform;
+
+    animation->after = transform;
+    stable_sort(animation->keys.begin(), animation->keys.end(),
+                [](const Keyframe &a, const Keyframe &b) { return a.time < b.time; });
+    return animation->at(animation->keys.front().time);
+}
+
+bool parseFile(const string &filename, Scene *scene) {
+    ifstream f (filename);
+    if (!f) {
+        cout << "ERROR: Could not open scene file " << filename << endl;
+        return false;
+    }
+
+    string line;
+    vec3 colour;
+    vec3 sColour;
+
+    // primitives go into the world object unless inside an object block
+    ObjectDef *target = &scene->world;
+
+    while(getline(f, line)) {
+        if (line.find("#") != string::npos)
+            continue;
+
+        // blocks are told apart by their leading keyword only, so that names
+        // such as "instance objectA" are not taken for another keyword
+        string keyword = parseKeyword(line);
+        if (keyword == "object") {
+            string name = parseName(line);
+            if (scene->findObject(name)) {
+                cout << "ERROR: Object " << name << " defined twice in " << filename << endl;
+            }
+            target = new ObjectDef(name);
+            scene->objects.push_back(target);
+        } else if (keyword == "instance") {
+            string name = parseName(line);
+            Animation animation;
+            mat4 transform = parseTransform(f, &animation);
+            ObjectDef *object = scene->findObject(name);
+            if (object) {
+                scene->instances.push_back(Instance(object, transform));
+                scene->instances.back().animation = animation;
+            } else {
+                cout << "ERROR: Instance of undefined object " << name << " in " << filename << endl;
+            }
+        } else if (keyword == "light") {
+           vec3 position;
+           float intensity;
+
+           getline(f, line);
+           sscanf(line.c_str(), "%f %f %f", &position.x, &position.y, &position.z);
+           getline(f, line);
+           sscanf(line.c_str(), "%f", &intensity);
+           skipBlock(f);
+
+           scene->light = Light(position, intensity);
+        } else if (keyword == "sphere") {
+            vec3 center;
+            float radius;
+
+            // Get the next 3 lines for center of sphere, radius, and colour
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &center.x, &center.y, &center.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f", &radius);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &colour.x, &colour.y, &colour.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &sColour.x, &sColour.y, &sColour.z);
+            skipBlock(f);
+
+            target->add(new Sphere(center, radius, colour, sColour));
+        } else if (keyword == "triangle") {
+            vec3 pointA;
+            vec3 pointB;
+            vec3 pointC;
+
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &pointA.x, &pointA.y, &pointA.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &pointB.x, &pointB.y, &pointB.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &pointC.x, &pointC.y, &pointC.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &colour.x, &colour.y, &colour.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &sColour.x, &sColour.y, &sColour.z);
+            skipBlock(f);
+
+            target->add(new Triangle(pointA, pointB, pointC, colour, sColour));
+        } else if (keyword == "plane") {
+            vec3 normal;
+            vec3 pointQ;
+
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &normal.x, &normal.y, &normal.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &pointQ.x, &pointQ.y, &pointQ.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &colour.x, &colour.y, &colour.z);
+            getline(f, line);
+            sscanf(line.c_str(), "%f %f %f", &sColour.x, &sColour.y, &sColour.z);
+            skipBlock(f);
+
+            target->add(new Plane(normal, pointQ, colour, sColour));
+        } else if (line.find("}") != string::npos) {
+            // closing brace of an object block
+            target = &scene->world;
+        }
+    }
+    f.close();
+
+    scene->build();
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// Generated Scenes
+
+void buildSphereField(Scene *scene, int rows, int columns) {
+    const vec3 colours[6] = { vec3(0.8, 0.1, 0.1), vec3(0.1, 0.7, 0.2), vec3(0.1, 0.2, 0.8),
+                              vec3(0.8, 0.7, 0.1), vec3(0.6, 0.1, 0.7), vec3(0.1, 0.7, 0.7) };
+    const float floorY = -2.75f;
+
+    scene->light = Light(vec3(0, 4, -2), 0.8f);
+    scene->world.add(new Plane(vec3(0, 1, 0), vec3(0, floorY, 0), vec3(0.5, 0.5, 0.5), vec3(0, 0, 0)));
+    scene->world.add(new Plane(vec3(0, 0, 1), vec3(0, 0, -80), vec3(0.2, 0.3, 0.4), vec3(0, 0, 0)));
+
+    // rows move back and spread wider, and the spheres in them grow, so the
+    // field fills the lower half of the view; a fixed seed jitters them
+    mt19937 rng(453);
+    uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+    uniform_real_distribution<float> size(0.0f, 1.0f);
+    for (int row = 0; row < rows; row++) {
+        float z = -5.0f - row * 0.55f;
+        float halfWidth = 6.0f + row * 0.35f;
+        for (int column = 0; column < columns; column++) {
+            float x = -halfWidth + column * (2.0f * halfWidth / std::max(columns - 1, 1)) + jitter(rng) * 0.1f;
+            float radius = 0.12f + 0.1f * size(rng) + row * 0.004f;
+            vec3 center(x, floorY + radius, z + jitter(rng) * 0.2f);
+
+            vec3 colour = colours[(row * 7 + column * 13) % 6];
+            vec3 specular = (row * columns + column) % 3 == 0 ? vec3(0.8, 0.8, 0.8) : vec3(0, 0, 0);
+            scene->world.add(new Sphere(center, radius, colour, specular));
+        }
+    }
+
+    scene->build();
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,238 @@
+// ==========================================================================
+// Scene Description and Acceleration Structures for Assignment 4
+//
+// A scene is a set of object definitions placed in the world by instances.
+// Primitives listed at the top level of a scene file belong to an implicit
+// world object with an identity instance, so a file without any object or
+// instance blocks behaves exactly as before.
+//
+// Rays are traced through a two level hierarchy: a BVH over the world bounds
+// of the instances, and one BVH per object definition in object space. Each
+// definition is stored once however many times it is instanced.
+// ==========================================================================
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "RayTracer.h"
+
+// --------------------------------------------------------------------------
+// A bounding volume hierarchy over a list of boxes. Nodes are stored depth
+// first, so the left child of an interior node immediately follows it.
+
+class BVH {
+public:
+    struct Node {
+        AABB box;
+        int first;  // leaves: first entry in order, interior: right child
+        int count;  // number of items in a leaf, 0 for interior nodes
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> order;
+
+    void build(const std::vector<AABB> &boxes);
+
+    // recomputes node boxes bottom up for moved items, keeping the topology
+    void refit(const std::vector<AABB> &boxes);
+
+    // calls visit(item) for every item whose leaf box overlaps [tmin, tmax].
+    // tmax is re-read as traversal goes so visit can shrink it
+    template <typename Visit>
+    void traverse(const Ray &r, const glm::vec3 &invDir, float tmin, const float &tmax,
+                  Visit visit) const {
+        if (nodes.empty())
+            return;
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            int index = stack[--top];
+            const Node &node = nodes[index];
+            if (!node.box.hit(r.origin, invDir, tmin, tmax))
+                continue;
+
+            if (node.count > 0) {
+                for (int i = node.first; i < node.first + node.count; i++)
+                    visit(order[i]);
+            } else {
+                stack[top++] = node.first;
+                stack[top++] = index + 1;
+            }
+        }
+    }
+
+private:
+    int buildNode(const std::vector<AABB> &boxes, int begin, int end);
+};
+
+// --------------------------------------------------------------------------
+// A named group of primitives, in its own object space.
+
+class ObjectDef {
+public:
+    std::string name;
+    std::vector<Shape*> shapes;     // shapes with finite bounds, in the BVH
+    std::vector<Shape*> unbounded;  // planes, tested against every ray
+    BVH bvh;
+    AABB bounds;
+
+    ObjectDef(const std::string &n): name(n) {}
+    ~ObjectDef();
+
+    void add(Shape *shape);
+    void build();
+    void refit();
+
+    // updates hit and returns true if something closer than hit->t was found
+    bool intersect(const Ray &r, float min, Hit *hit) const;
+
+private:
+    ObjectDef(const ObjectDef &);
+    ObjectDef &operator=(const ObjectDef &);
+};
+
+// --------------------------------------------------------------------------
+// One key of an animated transform: a translation, a rotation in degrees
+// about an axis and a scale, applied as translate * rotate * scale.
+
+struct Keyframe {
+    float time;
+    glm::vec3 translation;
+    float angle;
+    glm::vec3 axis;
+    glm::vec3 scale;
+
+    Keyframe(): time(0), translation(0), angle(0), axis(0, 1, 0), scale(1) {}
+};
+
+// A keyframed transform between the static transforms listed before and
+// after the keys. Each part of a key is interpolated linearly, so a key at
+// 0 degrees followed by one at 360 turns the object all the way round.
+
+class Animation {
+public:
+    glm::mat4 before;
+    glm::mat4 after;
+    std::vector<Keyframe> keys;  // sorted by time
+
+    Animation(): before(1.0f), after(1.0f) {}
+
+    bool empty() const { return keys.empty(); }
+
+    // the transform at time, held at the first and last keys outside them
+    glm::mat4 at(float time) const;
+};
+
+// --------------------------------------------------------------------------
+// One placement of an object definition in the world.
+
+class Instance {
+public:
+    const ObjectDef *object;
+    glm::mat4 toWorld;
+    glm::mat4 toObject;
+    bool identity;
+    AABB bounds;
+    Animation animation;
+
+    Instance(const ObjectDef *o, const glm::mat4 &transform);
+
+    // moves the instance, updating its inverse and world bounds
+    void setTransform(const glm::mat4 &transform);
+
+    // recomputes the world bounds from the object bounds and toWorld
+    void updateBounds();
+
+    // rays are moved into object space without renormalizing the direction,
+    // so the ray parameter of a hit is the same in both spaces
+    bool intersect(const Ray &r, float min, Hit *hit) const;
+
+    // world space normal of shape at the world space point
+    glm::vec3 getNormal(Shape *shape, glm::vec3 point) const;
+};
+
+// --------------------------------------------------------------------------
+// What an incremental update touched, for deciding what to re-render.
+
+struct SceneChanges {
+    bool everything;            // light or an unbounded shape changed or moved
+    std::vector<AABB> regions;  // world bounds of changed geometry, old and new
+
+    SceneChanges(): everything(false) {}
+};
+
+// world space bounds of box after transform
+AABB transformBox(const AABB &box, const glm::mat4 &transform);
+
+// --------------------------------------------------------------------------
+
+class Scene {
+public:
+    Light light;
+    ObjectDef world;
+    std::vector<ObjectDef*> objects;
+    std::vector<Instance> instances;
+
+    Scene();
+    ~Scene();
+
+    ObjectDef *findObject(const std::string &name) const;
+
+    // builds every object BVH and the top level BVH, call after loading
+    void build();
+
+    bool intersect(const Ray &r, float min, Hit *hit) const;
+
+    // time span covered by the keys of all animated instances, returning
+    // false if nothing in the scene is animated
+    bool timeRange(float *start, float *end) const;
+
+    // Moves every animated instance to its transform at time and refits the
+    // top level BVH. Object BVHs are left alone, so a frame costs one pass
+    // over the instances. The old and new bounds of each instance that moved
+    // are added to changes, if given.
+    void animate(float time, SceneChanges *changes);
+
+    // Takes the differences between this scene and edited, a fresh parse of
+    // the same file, swapping changed primitives and instance transforms in
+    // place and refitting the BVHs. Returns false without changing anything
+    // if objects, instances or primitives were added or removed, in which
+    // case the scene has to be replaced by edited.
+    bool update(Scene *edited, SceneChanges *changes);
+
+    // world bounds of every reflective surface, which may show any change;
+    // returns false if an unbounded shape is reflective
+    bool reflectors(std::vector<AABB> *boxes) const;
+
+private:
+    std::vector<int> bounded;    // instances in the top level BVH
+    std::vector<int> unbounded;  // instances containing planes
+    BVH top;
+
+    Scene(const Scene &);
+    Scene &operator=(const Scene &);
+};
+
+// --------------------------------------------------------------------------
+// File Parsing Functions
+
+// reads a scene file into scene and builds its acceleration structures
+bool parseFile(const std::string &filename, Scene *scene);
+
+// --------------------------------------------------------------------------
+// Generated Scenes
+
+// Fills scene with a field of rows x columns small spheres on a floor, every
+// third one reflective, receding from the camera towards a back wall. Each
+// sphere is its own primitive, so at 128 x 128 the shapes and their BVH take
+// several MB, for comparing ray orders on a scene larger than the caches.
+// The field is the same on every call.
+void buildSphereField(Scene *scene, int rows, int columns);
+
+// --------------------------------------------------------------------------
+#endif // SCENE_H
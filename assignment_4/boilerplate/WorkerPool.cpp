@@ -0,0 +1,83 @@
+// ==========================================================================
+// Persistent Worker Threads for Assignment 4
+// ==========================================================================
+
+#include "WorkerPool.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+WorkerPool::WorkerPool(unsigned int threads)
+    : job(0), jobCount(0), next(0), busy(0), generation(0), quit(false)
+{
+    if (threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+
+    for (unsigned int i = 1; i < threads; i++)
+        workers.push_back(thread(&WorkerPool::work, this, i));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(jobMutex);
+        quit = true;
+    }
+    jobReady.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+// --------------------------------------------------------------------------
+
+void WorkerPool::run(int count, const function<void(int, int)> &task)
+{
+    if (workers.empty()) {
+        for (int i = 0; i < count; i++)
+            task(i, 0);
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(jobMutex);
+        job = &task;
+        jobCount = count;
+        next = 0;
+        busy = workers.size();
+        generation++;
+    }
+    jobReady.notify_all();
+
+    drain(0);
+
+    unique_lock<mutex> lock(jobMutex);
+    jobDone.wait(lock, [this] { return busy == 0; });
+    job = 0;
+}
+
+void WorkerPool::drain(int worker)
+{
+    for (int i = next++; i < jobCount; i = next++)
+        (*job)(i, worker);
+}
+
+void WorkerPool::work(int worker)
+{
+    unsigned int seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(jobMutex);
+            jobReady.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+        }
+
+        drain(worker);
+
+        lock_guard<mutex> lock(jobMutex);
+        if (--busy == 0)
+            jobDone.notify_one();
+    }
+}
@@ -0,0 +1,54 @@
+// ==========================================================================
+// Persistent Worker Threads for Assignment 4
+//
+// A fixed set of threads that is started once and reused for every frame,
+// so rendering a sequence does not pay for thread creation on each image.
+// The thread calling run() works alongside the pool, and a pool of one
+// thread runs everything inline without starting any.
+// ==========================================================================
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+
+    // the job being run, handed out one index at a time
+    const std::function<void(int, int)> *job;
+    int jobCount;
+    std::atomic<int> next;
+    int busy;
+    unsigned int generation;
+    bool quit;
+
+    void work(int worker);
+    void drain(int worker);
+
+public:
+    // threads = 0 uses one thread per hardware thread
+    explicit WorkerPool(unsigned int threads = 0);
+    ~WorkerPool();
+
+    unsigned int size() const { return workers.size() + 1; }
+
+    // calls task(index, worker) for every index in [0, count) and returns
+    // once all calls have finished; worker is in [0, size())
+    void run(int count, const std::function<void(int, int)> &task);
+
+private:
+    WorkerPool(const WorkerPool &);
+    WorkerPool &operator=(const WorkerPool &);
+};
+
+// --------------------------------------------------------------------------
+#endif // WORKERPOOL_H
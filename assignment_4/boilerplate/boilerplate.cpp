@@ -26,6 +26,24 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "RayTracer.h"
+#include "Scene.h"
+#include "FileWatcher.h"
+#include "WorkerPool.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
 
 using namespace std;
 using namespace glm;
@@ -44,6 +62,23 @@ float focalLen = 470.0f;
 string scene1FileName = "scenes/scene1.txt";
 string scene2FileName = "scenes/scene2.txt";
 string scene3FileName = "scenes/scene3.txt";
+string scene4FileName = "scenes/scene4.txt";
+
+// Z-order tile traversal with binned reflections, or the original column
+// order; the column order stays the default, as the Z-order was only faster
+// on the large scene 5
+bool mortonOrder = false;
+bool reportStats = true;
+const uint32_t TILE_SIZE = 8;
+const uint32_t BIN_CELLS = 32;
+
+// reflection rays are handed to worker threads in batches of this many
+const int RAY_BATCH = 256;
+
+// depth of the camera near plane, and how far shadows are followed when
+// working out which tiles an edit to a scene file can affect
+const float NEAR_DEPTH = 0.01f;
+const float SHADOW_REACH = 1000.0f;
 
 // --------------------------------------------------------------------------
 // Functions to set up OpenGL shader programs for rendering
@@ -212,7 +247,7 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         }
 
         if (key == GLFW_KEY_RIGHT) {
-            if (scene == 3)
+            if (scene == 5)
                 scene = 1;
             else
                 scene++;
@@ -220,241 +255,274 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 
         if (key == GLFW_KEY_LEFT) {
             if (scene == 1)
-                scene = 3;
+                scene = 5;
             else
                 scene--;
         }
-    }
-}
-
-// --------------------------------------------------------------------------
-// Math Functions
-
-float findMagnitude(vec3 v) {
-    return sqrt(pow(v.x, 2) + pow(v.y, 2) + pow(v.z, 2));
-}
-
-vec3 crossProduct(vec3 a, vec3 b) {
-    return vec3(a.y * b.z - a.z * b.y,
-                a.z * b.x - a.x * b.z,
-                a.x * b.y - a.y * b.x);
-}
 
-float dotProduct(vec3 a, vec3 b) {
-    return (a.x * b.x + a.y * b.y + a.z * b.z);
-}
-
-float findDiscriminant(float a, float b, float c) {
-    return pow(b, 2) -  a * c;
-}
+        if (key == GLFW_KEY_M) {
+            mortonOrder = !mortonOrder;
+        }
 
-float max(float a, float b) {
-    if (a > b) {
-        return a;
+        reportStats = true;
     }
-    return b;
 }
 
 // --------------------------------------------------------------------------
-// Support Classes
+// Performance Counters
 
-class Ray {
+// counts last level cache misses for the calling thread using the linux
+// perf_event interface, falling back to reporting -1 where unavailable
+class CacheMissCounter {
+    int fd;
 public:
-    vec3 origin;
-    vec3 direction;
-    Ray(vec3 o, vec3 d): origin(o), direction(d){}
-    void normalize() {
-        float mag = findMagnitude(direction);
-        direction.x /= mag;
-        direction.y /= mag;
-        direction.z /= mag;
+    CacheMissCounter(): fd(-1) {
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
     }
-};
 
-class Light {
-public:
-	vec3 position;
-    float intensity;
-    Light(vec3 p, float i): position(p), intensity(i) {}
-};
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
 
-class Shape {
-public:
-    vec3 colour;
-    vec3 specColour;
-    Shape(vec3 c, vec3 spc): colour(c), specColour(spc) {}
-    virtual float intersect(Ray r, float min) = 0;
-    virtual vec3 getNormal(vec3 point) = 0;
-    virtual ~Shape() {}
-};
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
 
-class Sphere: public Shape {
-public:
-    vec3 center;
-    float radius;
-    Sphere(vec3 c, float r, vec3 co, vec3 spc): Shape(co, spc), center(c), radius(r) {}
-    float intersect(Ray r, float min) {
-        vec3 originToCenter = r.origin - center;
-
-        float a = dotProduct(r.direction, r.direction);
-        float b = dotProduct(r.direction, originToCenter);
-        float c = dotProduct(originToCenter, originToCenter) - pow(radius, 2);
-
-        float discriminant = findDiscriminant(a, b, c);
-        if (discriminant < 0) {
-            return INFINITY;
+    long long stop() {
+        long long count = -1;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count))
+                count = -1;
         }
+#endif
+        return count;
+    }
+};
 
-        float t;
-        float t0 = (-b + sqrt(discriminant)) /  a;
-        float t1 = (-b - sqrt(discriminant)) / a;
+// --------------------------------------------------------------------------
+// Ray Ordering Functions
+
+// interleaves the lower 16 bits of x and y into a Morton (Z-order) code
+uint32_t mortonEncode(uint32_t x, uint32_t y) {
+    x &= 0x0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+
+    y &= 0x0000ffff;
+    y = (y | (y << 8)) & 0x00ff00ff;
+    y = (y | (y << 4)) & 0x0f0f0f0f;
+    y = (y | (y << 2)) & 0x33333333;
+    y = (y | (y << 1)) & 0x55555555;
+
+    return x | (y << 1);
+}
 
-        (t0 < t1) ? t = t0 : t = t1;
-        if (t < min) {
-            return INFINITY;
-        }
+// extracts the even bits of a Morton code
+uint32_t mortonCompact(uint32_t v) {
+    v &= 0x55555555;
+    v = (v | (v >> 1)) & 0x33333333;
+    v = (v | (v >> 2)) & 0x0f0f0f0f;
+    v = (v | (v >> 4)) & 0x00ff00ff;
+    v = (v | (v >> 8)) & 0x0000ffff;
+    return v;
+}
 
-        return t;
-    }
+void mortonDecode(uint32_t code, uint32_t* x, uint32_t* y) {
+    *x = mortonCompact(code);
+    *y = mortonCompact(code >> 1);
+}
 
-    vec3 getNormal(vec3 point) {
-        return point - center;
+// interleaves three 5 bit cell coordinates into a 15 bit Morton code
+uint32_t mortonEncode3(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t code = 0;
+    for (int b = 0; b < 5; b++) {
+        code |= ((x >> b) & 1) << (3 * b);
+        code |= ((y >> b) & 1) << (3 * b + 1);
+        code |= ((z >> b) & 1) << (3 * b + 2);
     }
-};
+    return code;
+}
 
-class Plane: public Shape {
-public:
-    vec3 normal;
-    vec3 pointQ;
-    Plane(vec3 n, vec3 q, vec3 co, vec3 spc): Shape(co, spc), normal(n), pointQ(q) {}
-    float intersect(Ray r, float min) {
-        float bottom = dot(r.direction, normal);
-        if (bottom == 0) {
-            return INFINITY;
-        }
+// --------------------------------------------------------------------------
+// Support Functions
 
-        float t = dot(pointQ, normal) / bottom;
-        if (t > min) {
-            return t;
-        }
-        return INFINITY;
+// A reflection ray waiting to be traced, along with the pixel it contributes
+// to and the accumulated specular weight of the path that spawned it.
+struct SecondaryRay {
+    Ray ray;
+    vec3 weight;
+    int pixel;
+    uint32_t key;
+    SecondaryRay(Ray r, vec3 w, int p): ray(r), weight(w), pixel(p), key(0) {}
+    bool operator<(const SecondaryRay &other) const { return key < other.key; }
+};
+
+// sorts secondary rays by direction octant and then by the Morton order of the
+// grid cell holding their origin, so rays traced together touch similar data
+void binRays(vector<SecondaryRay>* rays) {
+    if (rays->empty())
+        return;
+
+    vec3 lo(INFINITY, INFINITY, INFINITY);
+    vec3 hi(-INFINITY, -INFINITY, -INFINITY);
+    for (size_t i = 0; i < rays->size(); i++) {
+        lo = glm::min(lo, (*rays)[i].ray.origin);
+        hi = glm::max(hi, (*rays)[i].ray.origin);
     }
 
-    vec3 getNormal(vec3 point) {
-        return normal;
+    vec3 extent = hi - lo;
+    vec3 scale;
+    for (int k = 0; k < 3; k++)
+        scale[k] = extent[k] > 0 ? (BIN_CELLS - 1) / extent[k] : 0;
+
+    for (size_t i = 0; i < rays->size(); i++) {
+        SecondaryRay &sr = (*rays)[i];
+        uint32_t octant = (sr.ray.direction.x < 0 ? 1 : 0) |
+                          (sr.ray.direction.y < 0 ? 2 : 0) |
+                          (sr.ray.direction.z < 0 ? 4 : 0);
+        vec3 cell = (sr.ray.origin - lo) * scale;
+        sr.key = (octant << 15) | mortonEncode3(cell.x, cell.y, cell.z);
     }
-};
 
-class Triangle: public Shape {
-public:
-    vec3 pointA;
-    vec3 pointB;
-    vec3 pointC;
-    Triangle(vec3 a, vec3 b, vec3 c, vec3 co, vec3 spc):
-        Shape(co, spc), pointA(a), pointB(b), pointC(c) {}
-    float intersect(Ray r, float min) {
-		vec3 ve = r.origin;
-		vec3 vd = r.direction;
-		vec3 pa = pointA;
-		vec3 pb = pointB;
-		vec3 pc = pointC;
-
-		float a = pa.x - pb.x;
-		float b = pa.y - pb.y;
-		float c = pa.z - pb.z;
-		float d = pa.x - pc.x;
-		float e = pa.y - pc.y;
-		float f = pa.z - pc.z;
-		float g = vd.x;
-		float h = vd.y;
-		float i = vd.z;
-		float j = pa.x - ve.x;
-		float k = pa.y - ve.y;
-		float l = pa.z - ve.z;
-
-		float M = a * (e * i - h * f) + b * (g * f - d * i) + c * (d * h - e * g);
-
-		float t = -(f * (a * k - j * b) + e * (j * c - a * l) + d * (b * l - k * c)) / M;
-		float u = (i * (a * k - j * b) + h * (j * c - a * l) + g * (b * l - k * c)) / M;
-		float v = (j * (e * i - h * f) + k * (g * f - d * i) + l * (d * h - e * g)) / M;
-
-		if (t < min || u < 0 || u > 1 || v < 0 || (u + v) > 1) {
-            return INFINITY;
-        }
+    sort(rays->begin(), rays->end());
+}
 
-		return t;
+// collects the rays each worker spawned into rays, emptying the per-worker lists
+void gatherRays(vector<vector<SecondaryRay> >* spawned, vector<SecondaryRay>* rays) {
+    rays->clear();
+    for (size_t k = 0; k < spawned->size(); k++) {
+        rays->insert(rays->end(), (*spawned)[k].begin(), (*spawned)[k].end());
+        (*spawned)[k].clear();
     }
+}
 
-    vec3 getNormal(vec3 point) {
-        vec3 vab = pointB - pointA;
-        vec3 vac = pointC - pointA;
-        return crossProduct(vab, vac);
+// renders primary rays tile by tile in Z-order, then traces reflections
+// breadth first, one binned bounce at a time. If tiles is given, only the
+// marked tiles are re-rendered and the rest of the image is kept. Tiles and
+// batches of reflection rays are shared out over the threads of pool; each
+// pixel is written by one thread per pass, so no locking is needed.
+void generateRaysMorton(vector<vec2>* pts, vector<vec3>* colours, const Scene &s, int w, int h, float f,
+                        WorkerPool &pool, const vector<char>* tiles) {
+    bool partial = tiles && pts->size() == size_t(w * h) && colours->size() == size_t(w * h);
+    if (!partial) {
+        pts->resize(w * h);
+        colours->resize(w * h);
     }
-};
-
-// --------------------------------------------------------------------------
-// Support Functions
 
-vec3 getPixelColour(Ray r, vector<Shape*> shapes, Light light, int count) {
-    vec3 kd;
-    vec3 ks;
-    vec3 normal;
-    vec3 incidentPoint;
-
-    float I = light.intensity;
-    float Ia = 0.5;
-    float closert = INFINITY;
-
-    for(int i = 0; i < shapes.size(); i++){
-        float t = shapes.at(i)->intersect(r, 0);
-        if(t < closert){
-            closert = t;
-            incidentPoint = closert * r.direction;
-            kd = shapes.at(i)->colour;
-            ks = shapes.at(i)->specColour;
-            normal = shapes.at(i)->getNormal(incidentPoint);
-        }
+    vector<SecondaryRay> secondary;
+    vector<vector<SecondaryRay> > spawned(pool.size());
+
+    uint32_t tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t tilesY = (h + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t span = 1;
+    while (span < tilesX || span < tilesY)
+        span <<= 1;
+
+    vector<uint32_t> order;
+    for (uint32_t tile = 0; tile < span * span; tile++) {
+        uint32_t tx, ty;
+        mortonDecode(tile, &tx, &ty);
+        if (tx >= tilesX || ty >= tilesY)
+            continue;
+        if (partial && !(*tiles)[ty * tilesX + tx])
+            continue;
+        order.push_back(ty * tilesX + tx);
     }
 
-    vec3 l = light.position - incidentPoint;
+    pool.run(order.size(), [&](int k, int worker) {
+        uint32_t tx = order[k] % tilesX;
+        uint32_t ty = order[k] / tilesX;
 
-    l /= findMagnitude(l);
-    vec3 v = -incidentPoint / findMagnitude(incidentPoint);
-    normal /= findMagnitude(normal);
+        for (uint32_t p = 0; p < TILE_SIZE * TILE_SIZE; p++) {
+            uint32_t px, py;
+            mortonDecode(p, &px, &py);
+            int i = tx * TILE_SIZE + px;
+            int j = ty * TILE_SIZE + py;
+            if (i >= w || j >= h)
+                continue;
 
-    vec3 h = (v + l) / findMagnitude(v + l);
-    vec3 ka = kd;
+            float x = -w / 2 + i + 0.5;
+            float y = h / 2 - j + 0.5;
+            float z = -f;
+
+            Ray r = Ray(vec3(0, 0, 0), vec3(x, y, z));
+            r.normalize();
 
-    vec3 L = ka * Ia + kd * I * max(0, dot(normal, l)) + ks * I * max(0, pow(dot(normal, h), 100));
+            int pixel = j * w + i;
+            vec3 ks;
+            Ray reflectedRay = Ray(vec3(0, 0, 0), vec3(0, 0, 0));
+            (*colours)[pixel] = shadeRay(r, s, &ks, &reflectedRay);
+            (*pts)[pixel] = vec2(x/(w/2), y/(h/2));
 
-    Ray shadowRay = Ray(incidentPoint, l);
-    shadowRay.normalize();
-    for (int i = 0; i < shapes.size(); i++) {
-        vec3 intersectP = shapes.at(i)->intersect(shadowRay, 0.0001f) * shadowRay.direction;
-        if (findMagnitude(intersectP) < findMagnitude(light.position - shadowRay.origin)) {
-            L = ka * Ia;
+            if (findMagnitude(ks) > 0)
+                spawned[worker].push_back(SecondaryRay(reflectedRay, ks, pixel));
         }
+    });
+    gatherRays(&spawned, &secondary);
+
+    for (int bounce = 1; bounce <= MAX_BOUNCES && !secondary.empty(); bounce++) {
+        binRays(&secondary);
+
+        int batches = (secondary.size() + RAY_BATCH - 1) / RAY_BATCH;
+        pool.run(batches, [&](int batch, int worker) {
+            size_t end = std::min(secondary.size(), size_t(batch + 1) * RAY_BATCH);
+            for (size_t i = size_t(batch) * RAY_BATCH; i < end; i++) {
+                const SecondaryRay &sr = secondary[i];
+                vec3 ks;
+                Ray reflectedRay = Ray(vec3(0, 0, 0), vec3(0, 0, 0));
+                (*colours)[sr.pixel] += sr.weight * shadeRay(sr.ray, s, &ks, &reflectedRay);
+
+                if (findMagnitude(ks) > 0 && bounce < MAX_BOUNCES)
+                    spawned[worker].push_back(SecondaryRay(reflectedRay, sr.weight * ks, sr.pixel));
+            }
+        });
+        gatherRays(&spawned, &secondary);
     }
+}
 
-    vec3 rhs = 2 * dot(r.direction, normal) *  normal;
-    Ray reflectedRay = Ray(incidentPoint, r.direction - rhs);
-    reflectedRay.origin += 0.0001f * reflectedRay.direction;
-    reflectedRay.normalize();
-
-    if (findMagnitude(ks) > 0 && count < 10) {
-        vec3 ref = getPixelColour(reflectedRay, shapes, light, ++count);
-        L = L + ks * ref;
+void generateRays(vector<vec2>* pts, vector<vec3>* colours, const Scene &s, int w, int h, float f,
+                  WorkerPool &pool, const vector<char>* tiles = 0) {
+    if (mortonOrder) {
+        generateRaysMorton(pts, colours, s, w, h, f, pool, tiles);
+        return;
     }
 
-    return L;
-}
-
-void generateRays(vector<vec2>* pts, vector<vec3>* colours, vector<Shape*> s, Light l, int w, int h, float f) {
-    pts->clear();
-    colours-> clear();
+    // pixels are stored column by column here, so a frame from the other
+    // order is never partially redrawn
+    bool partial = tiles && pts->size() == size_t(w * h) && colours->size() == size_t(w * h);
+    if (!partial) {
+        pts->resize(w * h);
+        colours->resize(w * h);
+    }
 
+    uint32_t tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
     for (int i = 0; i < w; i++) {
         for (int j = 0; j < h; j++) {
+            if (partial && !(*tiles)[(j / TILE_SIZE) * tilesX + i / TILE_SIZE])
+                continue;
+
             float x = -w / 2 + i + 0.5;
             float y = h / 2 - j + 0.5;
             float z = -f;
@@ -462,84 +530,193 @@ void generateRays(vector<vec2>* pts, vector<vec3>* colours, vector<Shape*> s, Li
             Ray r = Ray(vec3(0, 0, 0), vec3(x, y, z));
             r.normalize();
 
-            vec3 colour = getPixelColour(r, s, l, 0);
+            vec3 colour = getPixelColour(r, s, 0);
 
-            pts->push_back(vec2(x/(w/2), y/(h/2)));
-            colours->push_back(colour);
+            int pixel = i * h + j;
+            (*pts)[pixel] = vec2(x/(w/2), y/(h/2));
+            (*colours)[pixel] = colour;
         }
     }
 }
 
 // --------------------------------------------------------------------------
-// File Parsing Functions
-
-void parseFile(string filename, vector<Shape*>* shapes, Light** l) {
-    ifstream f (filename);
-
-    string line;
-    vec3 colour;
-    vec3 sColour;
-
-    while(getline(f, line)) {
-        if(line.find("light") != string::npos && line.find("#") == string::npos) {
-           vec3 position;
-           float intensity;
-
-           getline(f, line);
-           sscanf(line.c_str(), "%f %f %f", &position.x, &position.y, &position.z);
-           getline(f, line);
-           sscanf(line.c_str(), "%f", &intensity);
-
-           *l = new Light(position, intensity);
-        } else if (line.find("sphere") != string::npos && line.find("#") == string::npos) {
-            vec3 center;
-            float radius;
-
-            // Get the next 3 lines for center of sphere, radius, and colour
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &center.x, &center.y, &center.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f", &radius);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &colour.x, &colour.y, &colour.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &sColour.x, &sColour.y, &sColour.z);
-
-            shapes->push_back(new Sphere(center, radius, colour, sColour));
-        } else if (line.find("triangle") != string::npos && line.find("#") == string::npos) {
-            vec3 pointA;
-            vec3 pointB;
-            vec3 pointC;
-
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &pointA.x, &pointA.y, &pointA.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &pointB.x, &pointB.y, &pointB.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &pointC.x, &pointC.y, &pointC.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &colour.x, &colour.y, &colour.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &sColour.x, &sColour.y, &sColour.z);
-
-            shapes->push_back(new Triangle(pointA, pointB, pointC, colour, sColour));
-        } else if (line.find("plane") != string::npos && line.find("#") == string::npos) {
-            vec3 normal;
-            vec3 pointQ;
-
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &normal.x, &normal.y, &normal.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &pointQ.x, &pointQ.y, &pointQ.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &colour.x, &colour.y, &colour.z);
-            getline(f, line);
-            sscanf(line.c_str(), "%f %f %f", &sColour.x, &sColour.y, &sColour.z);
-
-            shapes->push_back(new Plane(normal, pointQ, colour, sColour));
+// Scene Reloading Functions
+
+// grows the screen rectangle lo..hi (in pixels) by the projection of p,
+// returning false if p is at or behind the image plane of the camera
+bool growScreenBounds(vec3 p, int w, int h, float f, vec2 *lo, vec2 *hi) {
+    if (p.z > -NEAR_DEPTH)
+        return false;
+
+    vec2 pixel(f * p.x / -p.z + w / 2 - 0.5f, h / 2 + 0.5f - f * p.y / -p.z);
+    *lo = glm::min(*lo, pixel);
+    *hi = glm::max(*hi, pixel);
+    return true;
+}
+
+// Marks the tiles that box covers on screen, together with the shadow it can
+// cast: the box corners are pushed away from the light, and the extruded
+// edges are clipped where they pass behind the camera.
+void markTiles(const AABB &box, const Light &light, bool withShadow, int w, int h, float f,
+               vector<char>* tiles) {
+    if (box.empty())
+        return;
+
+    uint32_t tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+    bool inside = all(greaterThanEqual(light.position, box.lo)) && all(lessThanEqual(light.position, box.hi));
+
+    vec2 lo(INFINITY, INFINITY);
+    vec2 hi(-INFINITY, -INFINITY);
+    for (int c = 0; c < 8; c++) {
+        vec3 corner((c & 1) ? box.hi.x : box.lo.x,
+                    (c & 2) ? box.hi.y : box.lo.y,
+                    (c & 4) ? box.hi.z : box.lo.z);
+        if (!growScreenBounds(corner, w, h, f, &lo, &hi) || (withShadow && inside)) {
+            fill(tiles->begin(), tiles->end(), 1);
+            return;
+        }
+
+        if (withShadow) {
+            vec3 far = corner + SHADOW_REACH * normalize(corner - light.position);
+            if (far.z > -NEAR_DEPTH) {
+                float t = (-NEAR_DEPTH - corner.z) / (far.z - corner.z);
+                far = corner + t * (far - corner);
+            }
+            growScreenBounds(far, w, h, f, &lo, &hi);
         }
     }
-    f.close();
+
+    if (hi.x < 0 || hi.y < 0 || lo.x >= w || lo.y >= h)
+        return;
+
+    int x0 = std::max(0, int(floor(lo.x))) / TILE_SIZE;
+    int y0 = std::max(0, int(floor(lo.y))) / TILE_SIZE;
+    int x1 = std::min(w - 1, int(ceil(hi.x))) / TILE_SIZE;
+    int y1 = std::min(h - 1, int(ceil(hi.y))) / TILE_SIZE;
+    for (int ty = y0; ty <= y1; ty++) {
+        for (int tx = x0; tx <= x1; tx++)
+            (*tiles)[ty * tilesX + tx] = 1;
+    }
+}
+
+// marks the tiles that changes to scene can affect, returning false if the
+// whole image has to be redrawn
+bool markChanges(const Scene &scene, const SceneChanges &changes, int w, int h, float f,
+                 vector<char>* tiles) {
+    if (changes.everything)
+        return false;
+    if (changes.regions.empty())
+        return true;
+
+    // reflective surfaces can show the change from anywhere in the scene
+    vector<AABB> reflectors;
+    if (!scene.reflectors(&reflectors))
+        return false;
+
+    for (size_t i = 0; i < changes.regions.size(); i++)
+        markTiles(changes.regions[i], scene.light, true, w, h, f, tiles);
+    for (size_t i = 0; i < reflectors.size(); i++)
+        markTiles(reflectors[i], scene.light, false, w, h, f, tiles);
+    return true;
+}
+
+// Re-reads a scene file after it was saved. Edits that keep the same objects,
+// instances and primitive counts are applied in place with BVH refits, and
+// only the tiles they can affect are marked; anything else replaces the scene
+// and returns false so the whole image is redrawn.
+bool reloadScene(Scene **scene, const string &filename, int w, int h, float f, vector<char>* tiles) {
+    Scene *edited = new Scene();
+    if (!parseFile(filename, edited)) {
+        delete edited;
+        return true;
+    }
+
+    SceneChanges changes;
+    if (!(*scene)->update(edited, &changes)) {
+        delete *scene;
+        *scene = edited;
+        return false;
+    }
+    delete edited;
+
+    return markChanges(**scene, changes, w, h, f, tiles);
+}
+
+// --------------------------------------------------------------------------
+// Sequence Rendering Functions
+
+// writes an image stored row by row from the top as an 8 bit RGB PNG
+bool savePNG(const string &filename, const vector<vec3> &colours, int w, int h) {
+    vector<unsigned char> pixels(w * h * 3);
+    for (int i = 0; i < w * h; i++) {
+        for (int c = 0; c < 3; c++)
+            pixels[3 * i + c] = (unsigned char)(255 * clamp(colours[i][c], 0.f, 1.f));
+    }
+
+    if (!stbi_write_png(filename.c_str(), w, h, 3, pixels.data(), 0)) {
+        cout << "ERROR: Failed to write image " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// Renders frames evenly spaced over the keyframes of a scene file to numbered
+// PNGs named prefix0000.png, prefix0001.png, ... The scene is parsed and its
+// BVHs are built once, and the worker threads are started once. Each later
+// frame moves the animated instances, refits the top level BVH and traces
+// only the tiles that the moving instances, their shadows and any reflective
+// surfaces can cover, keeping the rest of the previous frame.
+int renderSequence(const string &filename, int frames, const string &prefix, int w, int h, float f) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    WorkerPool pool;
+    Scene scene;
+    if (!parseFile(filename, &scene))
+        return -1;
+
+    float first = 0, last = 0;
+    if (!scene.timeRange(&first, &last))
+        cout << "WARNING: Nothing in " << filename << " is animated" << endl;
+
+    uint32_t tileCount = ((w + TILE_SIZE - 1) / TILE_SIZE) * ((h + TILE_SIZE - 1) / TILE_SIZE);
+    vector<char> dirtyTiles(tileCount, 0);
+    vector<vec2> points;
+    vector<vec3> colours;
+    double coldMs = 0;
+    double warmMs = 0;
+
+    for (int frame = 0; frame < frames; frame++) {
+        float time = frames > 1 ? first + (last - first) * frame / (frames - 1) : first;
+
+        SceneChanges changes;
+        scene.animate(time, &changes);
+        fill(dirtyTiles.begin(), dirtyTiles.end(), 0);
+        bool full = frame == 0 || !markChanges(scene, changes, w, h, f, &dirtyTiles);
+        uint32_t tilesRendered = full ? tileCount : count(dirtyTiles.begin(), dirtyTiles.end(), 1);
+
+        generateRaysMorton(&points, &colours, scene, w, h, f, pool, full ? 0 : &dirtyTiles);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        char name[32];
+        snprintf(name, sizeof(name), "%04d.png", frame);
+        if (!savePNG(prefix + name, colours, w, h))
+            return -1;
+
+        cout << "Frame " << frame << " (t = " << time << "): " << tilesRendered << " of "
+             << tileCount << " tiles in " << ms << " ms" << endl;
+        if (frame == 0)
+            coldMs = ms;
+        else
+            warmMs += ms;
+        start = chrono::steady_clock::now();
+    }
+
+    cout << "Rendered " << frames << " frames on " << pool.size() << " threads: first frame "
+         << coldMs << " ms";
+    if (frames > 1)
+        cout << ", later frames " << warmMs / (frames - 1) << " ms on average";
+    cout << endl;
+    return 0;
 }
 
 // ==========================================================================
@@ -547,6 +724,16 @@ void parseFile(string filename, vector<Shape*>* shapes, Light** l) {
 
 int main(int argc, char *argv[])
 {
+	// sequences are rendered straight to image files, without a window
+	if (argc > 1 && string(argv[1]) == "--sequence") {
+		if (argc < 4) {
+			cout << "Usage: " << argv[0] << " --sequence <scene file> <frames> [output prefix]" << endl;
+			return -1;
+		}
+		string prefix = argc > 4 ? argv[4] : "frame";
+		return renderSequence(argv[2], atoi(argv[3]), prefix, 512, 512, focalLen);
+	}
+
 	// initialize the GLFW windowing system
 	if (!glfwInit()) {
 		cout << "ERROR: GLFW failed to initialize, TERMINATING" << endl;
@@ -589,16 +776,12 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-    vector<Shape*> scene1Shapes;
-    vector<Shape*> scene2Shapes;
-    vector<Shape*> scene3Shapes;
-    Light* light1;
-    Light* light2;
-    Light* light3;
+    // scene 5 is generated rather than read from a file
+    string sceneFileNames[5] = { scene1FileName, scene2FileName, scene3FileName, scene4FileName, "" };
 
-    parseFile(scene1FileName, &scene1Shapes, &light1);
-    parseFile(scene2FileName, &scene2Shapes, &light2);
-    parseFile(scene3FileName, &scene3Shapes, &light3);
+    // scenes are loaded the first time they are shown, so the large
+    // generated one costs nothing unless it is looked at
+    Scene *scenes[5] = { 0, 0, 0, 0, 0 };
 
     vector<vec2> points;
     vector<vec3> colours;
@@ -612,17 +795,75 @@ int main(int argc, char *argv[])
 		cout << "Failed to load geometry" << endl;
 
 
+    CacheMissCounter cacheMisses;
+
+    // the window is rendered on this thread alone, so that the cache-miss
+    // counter, which only follows the calling thread, sees all of the work
+    WorkerPool pool(1);
+
+    // the image is only re-rendered when the view or the scene file changes
+    FileWatcher watcher;
+    int watchedScene = 0;
+    int renderedScene = 0;
+    float renderedFocalLen = 0;
+    bool renderedMorton = mortonOrder;
+    uint32_t tileCount = ((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE);
+    vector<char> dirtyTiles(tileCount, 0);
+
 	// run an event-triggered main loop
 	while (!glfwWindowShouldClose(window))
 	{
-        if (scene == 1) {
-            generateRays(&points, &colours, scene1Shapes, *light1, width, height, focalLen);
-        } else if (scene == 2) {
-            generateRays(&points, &colours, scene2Shapes, *light2, width, height, focalLen);
-        } else {
-            generateRays(&points, &colours, scene3Shapes, *light3, width, height, focalLen);
+        if (!scenes[scene - 1]) {
+            scenes[scene - 1] = new Scene();
+            if (sceneFileNames[scene - 1].empty())
+                buildSphereField(scenes[scene - 1], 128, 128);
+            else
+                parseFile(sceneFileNames[scene - 1], scenes[scene - 1]);
+        }
+
+        if (scene != watchedScene) {
+            if (!sceneFileNames[scene - 1].empty())
+                watcher.watch(sceneFileNames[scene - 1]);
+            watchedScene = scene;
+        }
+
+        bool full = scene != renderedScene || focalLen != renderedFocalLen || mortonOrder != renderedMorton;
+        bool reloaded = false;
+        if (watcher.changed() && !sceneFileNames[scene - 1].empty()) {
+            reloaded = true;
+            if (!reloadScene(&scenes[scene - 1], sceneFileNames[scene - 1], width, height, focalLen, &dirtyTiles))
+                full = true;
+        }
+
+        uint32_t tilesRendered = full ? tileCount : count(dirtyTiles.begin(), dirtyTiles.end(), 1);
+        if (tilesRendered > 0) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            cacheMisses.start();
+
+            generateRays(&points, &colours, *scenes[scene - 1], width, height, focalLen, pool,
+                         full ? 0 : &dirtyTiles);
+
+            long long misses = cacheMisses.stop();
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            if (reloaded) {
+                cout << "Reloaded scene " << scene << ": " << tilesRendered << " of "
+                     << tileCount << " tiles in " << ms << " ms" << endl;
+            } else if (reportStats) {
+                cout << "Scene " << scene << " (" << (mortonOrder ? "morton" : "linear")
+                     << "): " << ms << " ms, ";
+                if (misses >= 0)
+                    cout << misses << " cache misses" << endl;
+                else
+                    cout << "cache misses unavailable" << endl;
+                reportStats = false;
+            }
+
+            LoadGeometry(&geometry, points.data(), colours.data(), points.size());
+            fill(dirtyTiles.begin(), dirtyTiles.end(), 0);
+            renderedScene = scene;
+            renderedFocalLen = focalLen;
+            renderedMorton = mortonOrder;
         }
-        LoadGeometry(&geometry, points.data(), colours.data(), points.size());
 		// call function to draw our scene
 		RenderScene(&geometry, program);
 
@@ -632,6 +873,8 @@ int main(int argc, char *argv[])
 	}
 
 	// clean up allocated resources before exit
+	for (int i = 0; i < 5; i++)
+		delete scenes[i];
 	DestroyGeometry(&geometry);
 	glUseProgram(0);
 	glDeleteProgram(program);